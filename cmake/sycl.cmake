@@ -0,0 +1,76 @@
+# SYCL toolchain and target selection shared by the superproject and the standalone primitive builds.
+# Must be included before project() so that the compiler can still be chosen.
+include_guard(GLOBAL)
+
+set(SYCL_TARGET "cuda" CACHE STRING "SYCL target : cuda, spir64 (OpenCL/Level-Zero JIT), spir64_x86_64 (OpenCL CPU AOT), acpp-omp (AdaptiveCpp OpenMP host)")
+set_property(CACHE SYCL_TARGET PROPERTY STRINGS cuda spir64 spir64_x86_64 acpp-omp)
+set(SYCL_ROOT "$ENV{SYCL_ROOT}" CACHE PATH "Root of a DPC++/oneAPI or AdaptiveCpp installation (optional if the compiler is in PATH)")
+set(SYCL_PRIMITIVES_DEVICE "" CACHE STRING "Runtime device passed to the benchmarks as --device (gpu, cpu, acc, <index> or a name substring)")
+
+
+# Compiler : an explicit CMAKE_CXX_COMPILER (or CXX) always wins
+if(NOT CMAKE_CXX_COMPILER AND NOT DEFINED ENV{CXX})
+    if(SYCL_TARGET STREQUAL "acpp-omp")
+        find_program(SYCL_CXX NAMES acpp syclcc HINTS ${SYCL_ROOT}/bin)
+    else()
+        find_program(SYCL_CXX NAMES clang++ icpx HINTS ${SYCL_ROOT}/bin NO_DEFAULT_PATH)
+        find_program(SYCL_CXX NAMES icpx clang++)
+    endif()
+    if(SYCL_CXX)
+        set(CMAKE_CXX_COMPILER ${SYCL_CXX})
+    endif()
+endif()
+
+
+# Compile/link options of the selected target
+if(SYCL_TARGET STREQUAL "cuda")
+    set(SYCL_COMPILE_OPTION -fsycl -fsycl-targets=nvptx64-nvidia-cuda)
+elseif(SYCL_TARGET STREQUAL "spir64")
+    set(SYCL_COMPILE_OPTION -fsycl -fsycl-targets=spir64)
+elseif(SYCL_TARGET STREQUAL "spir64_x86_64")
+    set(SYCL_COMPILE_OPTION -fsycl -fsycl-targets=spir64_x86_64)
+elseif(SYCL_TARGET STREQUAL "acpp-omp")
+    set(SYCL_COMPILE_OPTION --acpp-targets=omp)
+else()
+    message(FATAL_ERROR "Unknown SYCL_TARGET '${SYCL_TARGET}'")
+endif()
+
+# CPU targets run the reduced problem sizes of the drivers by default
+if(SYCL_TARGET STREQUAL "cuda")
+    option(SYCL_PRIMITIVES_SMALL_PROBLEM "Use the reduced problem sizes (__MODE_SMALL_PROBLEM__)" OFF)
+else()
+    option(SYCL_PRIMITIVES_SMALL_PROBLEM "Use the reduced problem sizes (__MODE_SMALL_PROBLEM__)" ON)
+endif()
+
+
+# add_sycl_primitive(<name>) : builds <name>.out from <name>.cpp and a bench_<name> target running it
+function(add_sycl_primitive name)
+
+    set(APP ${name}.out)
+    set(MAIN ${name}.cpp)
+
+    find_package(Threads REQUIRED)
+    add_executable(${APP} ${MAIN})
+
+    if(SYCL_ROOT AND EXISTS ${SYCL_ROOT}/include/sycl)
+        target_include_directories(${APP} PUBLIC ${SYCL_ROOT}/include/sycl)
+    endif()
+    target_compile_options(${APP} PUBLIC ${SYCL_COMPILE_OPTION})
+    if(SYCL_PRIMITIVES_SMALL_PROBLEM)
+        target_compile_definitions(${APP} PUBLIC __MODE_SMALL_PROBLEM__)
+    endif()
+
+    target_link_libraries(${APP} PUBLIC Threads::Threads)
+    if(SYCL_ROOT AND EXISTS ${SYCL_ROOT}/lib)
+        target_link_directories(${APP} PUBLIC ${SYCL_ROOT}/lib)
+    endif()
+    target_link_options(${APP} PUBLIC ${SYCL_COMPILE_OPTION})
+
+    set(BENCH_ARGS "")
+    if(SYCL_PRIMITIVES_DEVICE)
+        set(BENCH_ARGS --device=${SYCL_PRIMITIVES_DEVICE})
+    endif()
+    add_custom_target(bench_${name} COMMAND ${APP} ${BENCH_ARGS} DEPENDS ${APP} USES_TERMINAL)
+    set_property(GLOBAL APPEND PROPERTY SYCL_PRIMITIVES_BENCHMARKS bench_${name})
+
+endfunction()
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <limits>
+#include <cstdlib>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+
+
+/********************************************************
+ *  Auto-tuner with a persistent tuning cache
+ *  - A primitive declares a search space of configurations (a list of integer parameters)
+ *  - The first call on a (primitive, device, dtype, problem-size bucket) sweeps the space and keeps the fastest
+ *  - Winners are stored in SYCL_PRIMITIVES_TUNING_CACHE (default ~/.sycl-primitives-tuning),
+ *    one "key<TAB>p0 p1 ..." line per entry, so later runs dispatch without tuning
+ ********************************************************/
+
+using TuningConfig = std::vector<int>;
+
+template <typename T> inline const char* dtype_name() { return "unknown"; }
+template <> inline const char* dtype_name<int>() { return "int"; }
+template <> inline const char* dtype_name<long>() { return "long"; }
+template <> inline const char* dtype_name<float>() { return "float"; }
+template <> inline const char* dtype_name<double>() { return "double"; }
+template <> inline const char* dtype_name<unsigned int>() { return "uint"; }
+
+// Problem sizes within a factor of two share a configuration
+inline int size_bucket(size_t size) {
+    int bucket = 0;
+    while (size > 1) { size >>= 1; bucket++; }
+    return bucket;
+}
+
+template <typename T>
+std::string tuning_key(const std::string& primitive, sycl::queue& queue, size_t size) {
+    std::ostringstream key;
+    key << primitive << "|" << queue.get_device().get_info<sycl::info::device::name>()
+        << "|" << dtype_name<T>() << "|" << size_bucket(size);
+    return key.str();
+}
+
+
+class TuningCache {
+
+    public:
+        static TuningCache& instance() {
+            static TuningCache cache;
+            return cache;
+        }
+
+        bool find(const std::string& key, TuningConfig& config) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it == entries.end()) return false;
+            config = it->second;
+            return true;
+        }
+
+        void store(const std::string& key, const TuningConfig& config) {
+            std::lock_guard<std::mutex> lock(mutex);
+            entries[key] = config;
+
+            std::ofstream file(path, std::ios::app);
+            if (!file) return;
+            file << key << "\t";
+            for (size_t i=0; i<config.size(); i++) file << (i ? " " : "") << config[i];
+            file << "\n";
+        }
+
+        const std::string& file() const { return path; }
+
+
+    private:
+        TuningCache() {
+            const char* env = std::getenv("SYCL_PRIMITIVES_TUNING_CACHE");
+            const char* home = std::getenv("HOME");
+            if (env != nullptr && env[0] != '\0') path = env;
+            else path = std::string(home ? home : ".") + "/.sycl-primitives-tuning";
+
+            // Later lines override earlier ones, so re-tuned entries can simply be appended
+            std::ifstream in(path);
+            std::string line;
+            while (std::getline(in, line)) {
+                size_t tab = line.find('\t');
+                if (tab == std::string::npos) continue;
+                std::istringstream values(line.substr(tab+1));
+                TuningConfig config;
+                int value;
+                while (values >> value) config.push_back(value);
+                entries[line.substr(0, tab)] = config;
+            }
+        }
+
+        std::mutex mutex;
+        std::string path;
+        std::map<std::string, TuningConfig> entries;
+};
+
+
+/********************************************************
+ *  Return the tuned configuration of key
+ *  - run(config) executes the primitive once with config and waits for it
+ *  - Configurations throwing a sycl::exception (e.g. unsupported work-group size) are skipped
+ ********************************************************/
+template <typename Run>
+TuningConfig autotune(const std::string& key, const std::vector<TuningConfig>& space, Run run, int repeats=2) {
+
+    TuningConfig best;
+    if (TuningCache::instance().find(key, best)) {
+        for (auto& config : space)
+            if (config == best) return best;
+    }
+
+    double best_time = std::numeric_limits<double>::max();
+    for (auto& config : space) {
+        try {
+            run(config);    // warming up
+            auto st = std::chrono::steady_clock::now();
+            for (int r=0; r<repeats; r++) run(config);
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now()-st).count()/repeats;
+            if (time < best_time) {
+                best_time = time;
+                best = config;
+            }
+        } catch (sycl::exception& e) {
+            continue;
+        }
+    }
+
+    if (best.empty()) {
+        std::cout << "--- [[[ERROR]]] No valid configuration for "<<key<<" !!\n";
+        return space.front();
+    }
+
+    std::cout << "-- Tuned "<<key<<" : {";
+    for (size_t i=0; i<best.size(); i++) std::cout << (i ? ", " : "") << best[i];
+    std::cout << "} ("<<best_time<<" s)\n";
+
+    TuningCache::instance().store(key, best);
+    return best;
+}
+
+// Cartesian product of the parameter ranges, filtered by valid(config)
+template <typename Valid>
+std::vector<TuningConfig> tuning_space(const std::vector<std::vector<int>>& params, Valid valid) {
+
+    std::vector<TuningConfig> space(1);
+    for (auto& values : params) {
+        std::vector<TuningConfig> next;
+        for (auto& prefix : space) {
+            for (int value : values) {
+                TuningConfig config = prefix;
+                config.push_back(value);
+                next.push_back(config);
+            }
+        }
+        space.swap(next);
+    }
+
+    std::vector<TuningConfig> filtered;
+    for (auto& config : space)
+        if (valid(config)) filtered.push_back(config);
+    return filtered;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+
+
+/********************************************************
+ *  Runtime device selection
+ *  - --device=<gpu|cpu|acc|default|index|name substring>, or the SYCL_PRIMITIVES_DEVICE environment variable
+ *  - --list-devices prints the visible devices with their index and exits
+ ********************************************************/
+
+inline std::string device_option(int argc, char* argv[]) {
+
+    for (int i=1; i<argc; i++) {
+        if (std::strncmp(argv[i], "--device=", 9) == 0) return argv[i]+9;
+        if (std::strcmp(argv[i], "--device") == 0 && i+1<argc) return argv[i+1];
+    }
+
+    const char* env = std::getenv("SYCL_PRIMITIVES_DEVICE");
+    return (env != nullptr && env[0] != '\0') ? env : "default";
+}
+
+inline void list_devices() {
+
+    auto devices = sycl::device::get_devices();
+    for (size_t d=0; d<devices.size(); d++) {
+        std::cout << "["<<d<<"] "<<devices[d].get_info<sycl::info::device::name>()
+                  <<" ("<<devices[d].get_platform().get_info<sycl::info::platform::name>()<<")\n";
+    }
+}
+
+inline sycl::device select_device(int argc, char* argv[]) {
+
+    for (int i=1; i<argc; i++) {
+        if (std::strcmp(argv[i], "--list-devices") == 0) {
+            list_devices();
+            std::exit(0);
+        }
+    }
+
+    std::string option = device_option(argc, argv);
+    if (option == "default") return sycl::device(sycl::default_selector_v);
+    if (option == "gpu") return sycl::device(sycl::gpu_selector_v);
+    if (option == "cpu") return sycl::device(sycl::cpu_selector_v);
+    if (option == "acc") return sycl::device(sycl::accelerator_selector_v);
+
+    auto devices = sycl::device::get_devices();
+    if (option.find_first_not_of("0123456789") == std::string::npos) {
+        size_t index = std::stoul(option);
+        if (index < devices.size()) return devices[index];
+    } else {
+        for (auto& device : devices) {
+            if (device.get_info<sycl::info::device::name>().find(option) != std::string::npos) return device;
+        }
+    }
+
+    std::cout << "--- [[[ERROR]]] No device matches --device="<<option<<", using the default device !!\n";
+    list_devices();
+    return sycl::device(sycl::default_selector_v);
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+
+
+/********************************************************
+ *  Record and replay of a sequence of primitive calls
+ *  - The calls are submitted to an in-order queue of the same device, so consecutive calls of a pipeline are ordered
+ *  - With sycl_ext_oneapi_graph (DPC++), the calls are recorded once into a command_graph,
+ *    finalized, and every later run() is a single graph submission
+ *  - Up to RECORD_REPLAY_MAX_GRAPHS sets of pointers keep their own executable graph, so a loop alternating
+ *    between buffers (ping-pong, double buffering) replays without recording again
+ *  - A new set of pointers beyond that is recorded (host only, nothing runs) and its pointers are written
+ *    into the least recently run executable graph with command_graph::update, so memory stays bounded
+ *  - Without the extension (or if the device refuses the graph), run() simply submits the calls again
+ *  - record(queue) must only submit work : no wait(), i.e. the *_async / event-returning variants of the
+ *    primitives. Per-call scratch it returns to the memory pool (transform_reduce, the work queue counter
+ *    of persistent_launch) is not reused while recording, the graph keeps the pointers
+ ********************************************************/
+constexpr size_t RECORD_REPLAY_MAX_GRAPHS = 4;
+
+class RecordReplay {
+
+    public:
+        explicit RecordReplay(sycl::queue& queue)
+            : stream(queue.get_context(), queue.get_device(), sycl::property_list{sycl::property::queue::in_order()}) {
+            #ifdef SYCL_EXT_ONEAPI_GRAPH
+            native = true;
+            #endif
+        }
+
+        sycl::queue& queue() { return stream; }
+        bool is_native() const { return native; }
+        size_t num_graphs() const {
+            #ifdef SYCL_EXT_ONEAPI_GRAPH
+            return graphs.size();
+            #else
+            return 0;
+            #endif
+        }
+
+        void clear() {
+            #ifdef SYCL_EXT_ONEAPI_GRAPH
+            graphs.clear();
+            #endif
+        }
+
+        // pointers : the buffers used by record, the key of the recorded graph
+        template <typename Record>
+        sycl::event run(const std::vector<const void*>& pointers, Record record) {
+
+            #ifdef SYCL_EXT_ONEAPI_GRAPH
+            if (native) {
+                namespace exp = sycl::ext::oneapi::experimental;
+                runs++;
+                for (auto& recorded : graphs) {
+                    if (recorded.pointers != pointers) continue;
+                    recorded.last_run = runs;
+                    return stream.ext_oneapi_graph(recorded.graph);
+                }
+
+                std::unique_ptr<exp::command_graph<exp::graph_state::modifiable>> graph;
+                bool recording = false;
+                try {
+                    graph.reset(new exp::command_graph<exp::graph_state::modifiable>(stream.get_context(), stream.get_device()));
+                    graph->begin_recording(stream);
+                    recording = true;
+                    record(stream);
+                    graph->end_recording(stream);
+                    recording = false;
+
+                    if (graphs.size() < RECORD_REPLAY_MAX_GRAPHS) {
+                        graphs.push_back(Recorded{pointers, graph->finalize(exp::property::graph::updatable{}), runs});
+                        return stream.ext_oneapi_graph(graphs.back().graph);
+                    }
+
+                    // Same commands, other pointers : update the least recently run graph once its last run is done
+                    Recorded& lru = *std::min_element(graphs.begin(), graphs.end(),
+                                                      [](const Recorded& a, const Recorded& b) { return a.last_run < b.last_run; });
+                    stream.wait();
+                    try {
+                        lru.graph.update(*graph);
+                    } catch (sycl::exception&) {
+                        lru.graph = graph->finalize(exp::property::graph::updatable{});    // not the same commands
+                    }
+                    lru.pointers = pointers;
+                    lru.last_run = runs;
+                    return stream.ext_oneapi_graph(lru.graph);
+                } catch (sycl::exception& e) {
+                    if (recording) graph->end_recording(stream);
+                    std::cout << "-- [[[WARNING]]] command_graph unavailable ("<<e.what()<<"), falling back to re-submission\n";
+                    native = false;
+                    graphs.clear();
+                    return record(stream);
+                }
+            }
+            #endif
+
+            return record(stream);
+        }
+
+
+    private:
+        sycl::queue stream;
+        bool native = false;
+
+        #ifdef SYCL_EXT_ONEAPI_GRAPH
+        struct Recorded {
+            std::vector<const void*> pointers;
+            sycl::ext::oneapi::experimental::command_graph<sycl::ext::oneapi::experimental::graph_state::executable> graph;
+            size_t last_run;
+        };
+        std::vector<Recorded> graphs;
+        size_t runs = 0;
+        #endif
+};
+
+
+/********************************************************
+ *  Per-iteration host overhead of a submission loop
+ *  - submit(i) submits iteration i without waiting
+ *  - host : time spent in the submit calls of an iteration, total : wall time per iteration until completion
+ ********************************************************/
+struct SubmissionTiming {
+    double host;
+    double total;
+
+    void print(const char* label) const {
+        std::cout << "-- "<<label<<" : host submission "<<host*1e6<<" us/iteration, total "<<total*1e6<<" us/iteration\n";
+    }
+};
+
+template <typename Submit>
+SubmissionTiming measure_submission(sycl::queue& queue, int iterations, Submit submit) {
+
+    auto seconds = [](std::chrono::steady_clock::time_point st) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now()-st).count();
+    };
+
+    // Warming up with two iterations, which also records both sides of a ping-pong
+    submit(0);
+    submit(1);
+    queue.wait();
+
+    auto st = std::chrono::steady_clock::now();
+    for (int i=0; i<iterations; i++) submit(i);
+    double host = seconds(st);
+    queue.wait();
+    double total = seconds(st);
+    return SubmissionTiming{host/iterations, total/iterations};
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+
+
+/********************************************************
+ *  Blocked matrix layouts
+ *  - row_major : the plain [rows, cols] layout of every primitive
+ *  - blocked : tile-major, the tiles of tile x tile elements are stored one after the other in row-major
+ *    order of the tile grid, and every tile is row-major inside, so a tile is one contiguous block
+ *  - morton : same tiles, ordered along the Z-order curve of the tile grid (bits of the tile row and
+ *    column interleaved), so tiles close in 2D stay close in memory at every scale
+ *  - rows and cols are padded to a multiple of tile with zeros, so the kernels consuming the layout need
+ *    no bound checks (morton allocates the power-of-two square of tiles around the tile grid, the tiles
+ *    outside the grid are never accessed)
+ ********************************************************/
+enum class Layout { row_major, blocked, morton };
+
+inline const char* layout_name(Layout layout) {
+    switch (layout) {
+        case Layout::row_major: return "row-major";
+        case Layout::blocked:   return "blocked";
+        default:                return "morton";
+    }
+}
+
+// Spreads the low 32 bits of v over the even bit positions
+inline uint64_t morton_spread(uint64_t v) {
+    v &= 0xFFFFFFFFull;
+    v = (v | (v<<16)) & 0x0000FFFF0000FFFFull;
+    v = (v | (v<<8))  & 0x00FF00FF00FF00FFull;
+    v = (v | (v<<4))  & 0x0F0F0F0F0F0F0F0Full;
+    v = (v | (v<<2))  & 0x3333333333333333ull;
+    v = (v | (v<<1))  & 0x5555555555555555ull;
+    return v;
+}
+
+// Interleaves the bits of y (odd positions) and x (even positions)
+inline size_t morton_encode(size_t y, size_t x) {
+    return (size_t)(morton_spread(x) | (morton_spread(y)<<1));
+}
+
+
+/*** Shape of a [rows, cols] matrix in one of the layouts, passed by value to the kernels ***/
+struct MatrixLayout {
+    Layout layout;
+    size_t rows, cols;
+    size_t tile;
+    size_t tiles_rows, tiles_cols;    // tile grid of the padded matrix
+    size_t grid;                      // morton : side of the power-of-two tile grid
+
+    MatrixLayout(Layout layout, size_t rows, size_t cols, size_t tile=32)
+        : layout(layout), rows(rows), cols(cols), tile(layout == Layout::row_major ? 1 : tile),
+          tiles_rows((rows+this->tile-1)/this->tile), tiles_cols((cols+this->tile-1)/this->tile), grid(1) {
+        while (grid < tiles_rows || grid < tiles_cols) grid *= 2;
+    }
+
+    // Same layout and tile size for the transposed [cols, rows] matrix
+    MatrixLayout transposed() const { return MatrixLayout(layout, cols, rows, tile); }
+
+    // Number of elements to allocate
+    size_t size() const {
+        if (layout == Layout::row_major) return rows*cols;
+        if (layout == Layout::morton) return grid*grid*tile*tile;
+        return tiles_rows*tiles_cols*tile*tile;
+    }
+
+    // Offset of the first element of tile [ty, tx]
+    size_t tile_offset(size_t ty, size_t tx) const {
+        if (layout == Layout::morton) return morton_encode(ty, tx)*tile*tile;
+        return (ty*tiles_cols+tx)*tile*tile;
+    }
+
+    // Offset of element [y, x]
+    size_t offset(size_t y, size_t x) const {
+        if (layout == Layout::row_major) return y*cols+x;
+        return tile_offset(y/tile, x/tile)+(y%tile)*tile+x%tile;
+    }
+};
+
+
+/********************************************************
+ *  Conversions between row-major and a blocked layout
+ *  - One work-group per tile (tile/WPI x tile items, WPI rows each), so the row-major side and the tile
+ *    side are both accessed in contiguous runs of tile elements
+ *  - tile must be a multiple of WPI
+ *  - to_layout writes the padding as zeros, from_layout drops it
+ ********************************************************/
+template <typename T, size_t WPI=4>
+sycl::event to_layout(sycl::queue& queue, const T* in, T* out, const MatrixLayout layout) {
+
+    if (layout.layout == Layout::row_major)
+        return queue.memcpy(out, in, sizeof(T)*layout.rows*layout.cols);
+
+    const size_t tile = layout.tile;
+    return queue.submit([&] (sycl::handler& cgh) {
+        cgh.parallel_for(sycl::nd_range<2>({layout.tiles_rows*tile/WPI, layout.tiles_cols*tile}, {tile/WPI, tile}), [=](sycl::nd_item<2> item) {
+            size_t x = item.get_global_id(1);
+            size_t base = layout.tile_offset(item.get_group(0), x/tile)+x%tile;
+            for (size_t work=0; work<WPI; work++) {
+                size_t ly = item.get_local_id(0)+work*(tile/WPI);
+                size_t y = item.get_group(0)*tile+ly;
+                out[base+ly*tile] = (y<layout.rows && x<layout.cols) ? in[y*layout.cols+x] : (T)0;
+            }
+        });
+    });
+}
+
+template <typename T, size_t WPI=4>
+sycl::event from_layout(sycl::queue& queue, const T* in, T* out, const MatrixLayout layout) {
+
+    if (layout.layout == Layout::row_major)
+        return queue.memcpy(out, in, sizeof(T)*layout.rows*layout.cols);
+
+    const size_t tile = layout.tile;
+    return queue.submit([&] (sycl::handler& cgh) {
+        cgh.parallel_for(sycl::nd_range<2>({layout.tiles_rows*tile/WPI, layout.tiles_cols*tile}, {tile/WPI, tile}), [=](sycl::nd_item<2> item) {
+            size_t x = item.get_global_id(1);
+            size_t base = layout.tile_offset(item.get_group(0), x/tile)+x%tile;
+            for (size_t work=0; work<WPI; work++) {
+                size_t ly = item.get_local_id(0)+work*(tile/WPI);
+                size_t y = item.get_group(0)*tile+ly;
+                if (y<layout.rows && x<layout.cols)
+                    out[y*layout.cols+x] = in[base+ly*tile];
+            }
+        });
+    });
+}
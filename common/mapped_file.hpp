@@ -0,0 +1,321 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <optional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+
+
+/********************************************************
+ *  Memory-mapped input/output files
+ *  - Raw binary files (no header) and .npy files (version 1.0 header, little-endian, C order)
+ *  - The payload is mmap'ed, so a primitive reads its chunks straight from the page cache, and an output
+ *    file is written through its mapping : no std::vector copy of the whole file on either side
+ *  - register_for_device_copy : with sycl_ext_oneapi_copy_optimize (DPC++), the mapping is pinned with
+ *    prepare_for_device_copy, so queue.memcpy moves chunks between the file pages and the device directly;
+ *    elsewhere it returns false and the caller stages the chunks through malloc_host buffers (StreamingEngine)
+ *  - npy_read_header / npy_header are shared with the plain fread/fwrite path used as the baseline
+ ********************************************************/
+
+// Directory of the benchmark data files : SYCL_PRIMITIVES_DATA_DIR (default /tmp)
+inline std::string data_file_path(const std::string& name) {
+    const char* dir = std::getenv("SYCL_PRIMITIVES_DATA_DIR");
+    return std::string(dir ? dir : "/tmp")+"/"+name;
+}
+
+template <typename T> inline const char* npy_descr();
+template <> inline const char* npy_descr<int>()       { return "<i4"; }
+template <> inline const char* npy_descr<long>()      { return "<i8"; }
+template <> inline const char* npy_descr<float>()     { return "<f4"; }
+template <> inline const char* npy_descr<double>()    { return "<f8"; }
+
+struct NpyHeader {
+    std::string descr;
+    std::vector<size_t> shape;  // empty for a raw file
+    size_t data_offset = 0;     // bytes before the payload (0 for a raw file)
+
+    size_t count() const {
+        size_t n = 1;
+        for (size_t s : shape) n *= s;
+        return n;
+    }
+};
+
+inline bool has_npy_extension(const std::string& path) {
+    return path.size() >= 4 && path.compare(path.size()-4, 4, ".npy") == 0;
+}
+
+// Header of a .npy file : magic, version 1.0, header length, dict, padded with spaces to a multiple of 64 bytes
+inline std::string npy_header(const char* descr, const std::vector<size_t>& shape) {
+
+    std::string dict = std::string("{'descr': '")+descr+"', 'fortran_order': False, 'shape': (";
+    for (size_t s : shape) dict += std::to_string(s)+", ";
+    dict += "), }";
+
+    size_t total = ((10+dict.size()+1+63)/64)*64;
+    dict.append(total-10-dict.size()-1, ' ');
+    dict += '\n';
+
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header += (char)(dict.size()&0xff);
+    header += (char)(dict.size()>>8);
+    return header+dict;
+}
+
+// Parses the .npy header at the start of bytes (size : bytes available), false if it is not a .npy header we support
+inline bool npy_parse_header(const char* bytes, size_t size, NpyHeader& header) {
+
+    if (size < 10 || std::memcmp(bytes, "\x93NUMPY", 6) != 0) return false;
+    size_t length, offset;
+    if (bytes[6] == 1) { length = (uint8_t)bytes[8] | ((size_t)(uint8_t)bytes[9]<<8); offset = 10; }
+    else {
+        if (size < 12) return false;
+        length = (uint8_t)bytes[8] | ((size_t)(uint8_t)bytes[9]<<8) | ((size_t)(uint8_t)bytes[10]<<16) | ((size_t)(uint8_t)bytes[11]<<24);
+        offset = 12;
+    }
+    if (offset+length > size) return false;
+    std::string dict(bytes+offset, length);
+
+    size_t descr = dict.find("'descr'");
+    size_t order = dict.find("'fortran_order'");
+    size_t shape = dict.find("'shape'");
+    if (descr == std::string::npos || order == std::string::npos || shape == std::string::npos) return false;
+    size_t order_value = dict.find_first_not_of(" :", order+15);
+    if (order_value == std::string::npos) return false;
+    if (dict.compare(order_value, 4, "True") == 0) {
+        std::cout << "--- [[[ERROR]]] Fortran-ordered .npy files are not supported !!\n";
+        return false;
+    }
+
+    size_t colon = dict.find(':', descr);
+    size_t quote = colon == std::string::npos ? colon : dict.find('\'', colon+1);
+    size_t quote_end = quote == std::string::npos ? quote : dict.find('\'', quote+1);
+    size_t paren = dict.find('(', shape);
+    size_t close = paren == std::string::npos ? paren : dict.find(')', paren);
+    if (quote_end == std::string::npos || close == std::string::npos) return false;
+    header.descr = dict.substr(quote+1, quote_end-quote-1);
+
+    header.shape.clear();
+    for (size_t pos=paren+1; pos<close; ) {
+        size_t digit = dict.find_first_of("0123456789", pos);
+        if (digit == std::string::npos || digit > close) break;
+        size_t value = 0;
+        for (pos=digit; pos<close && dict[pos]>='0' && dict[pos]<='9'; pos++) {
+            if (value > (SIZE_MAX-9)/10) return false;
+            value = value*10+(dict[pos]-'0');
+        }
+        header.shape.push_back(value);
+    }
+    header.data_offset = offset+length;
+    return true;
+}
+
+inline bool npy_read_header(std::FILE* file, NpyHeader& header) {
+    char bytes[4096];
+    size_t size = std::fread(bytes, 1, sizeof(bytes), file);
+    bool npy = npy_parse_header(bytes, size, header);
+    std::fseek(file, npy ? header.data_offset : 0, SEEK_SET);
+    return npy;
+}
+
+
+/*** Plain buffered I/O of a whole raw or .npy file (the read-then-memcpy baseline, and writing test inputs) ***/
+template <typename T>
+bool npy_fread(const std::string& path, T* data, size_t count) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) { std::cout << "--- [[[ERROR]]] Cannot open "<<path<<" !!\n"; return false; }
+    NpyHeader header;
+    bool npy = npy_read_header(file, header);
+    if (!npy && has_npy_extension(path)) {
+        std::cout << "--- [[[ERROR]]] "<<path<<" has no valid .npy header !!\n";
+        std::fclose(file);
+        return false;
+    }
+    if (npy && (header.descr != npy_descr<T>() || header.count() != count)) {
+        std::cout << "--- [[[ERROR]]] "<<path<<" holds "<<header.count()<<" "<<header.descr<<" values, expected "<<count<<" "<<npy_descr<T>()<<" !!\n";
+        std::fclose(file);
+        return false;
+    }
+    size_t read = std::fread(data, sizeof(T), count, file);
+    std::fclose(file);
+    if (read != count) std::cout << "--- [[[ERROR]]] Read "<<read<<" values out of "<<count<<" from "<<path<<" !!\n";
+    return read == count;
+}
+
+template <typename T>
+bool npy_fwrite(const std::string& path, const T* data, const std::vector<size_t>& shape) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) { std::cout << "--- [[[ERROR]]] Cannot create "<<path<<" !!\n"; return false; }
+    std::string header = has_npy_extension(path) ? npy_header(npy_descr<T>(), shape) : std::string();
+    size_t count = NpyHeader{"", shape, 0}.count();
+    bool written = std::fwrite(header.data(), 1, header.size(), file) == header.size()
+                && std::fwrite(data, sizeof(T), count, file) == count;
+    written = std::fclose(file) == 0 && written;
+    if (!written) std::cout << "--- [[[ERROR]]] Cannot write "<<path<<" !!\n";
+    return written;
+}
+
+
+class MappedFile {
+
+    public:
+        // Opens an existing raw or .npy file read-only
+        explicit MappedFile(const std::string& path) : path(path), writable(false) {
+
+            fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) { std::cout << "--- [[[ERROR]]] Cannot open "<<path<<" !!\n"; return; }
+            struct stat st;
+            if (fstat(fd, &st) != 0) { std::cout << "--- [[[ERROR]]] Cannot stat "<<path<<" !!\n"; return; }
+            map((size_t)st.st_size, PROT_READ);
+            if (base == nullptr) return;
+
+            if (!npy_parse_header((const char*)base, map_bytes, header)) {
+                header = NpyHeader();    // raw file : the caller knows the shape, see count<T>()
+                if (has_npy_extension(path)) {
+                    std::cout << "--- [[[ERROR]]] "<<path<<" has no valid .npy header !!\n";
+                    unmap();
+                    return;
+                }
+            }
+            madvise(base, map_bytes, MADV_SEQUENTIAL);
+        }
+
+        // Opens an existing file holding count elements of T : a .npy file must have T's descr and count elements,
+        // a raw file exactly count elements; any mismatch is reported and the file is left closed (is_open() false)
+        template <typename T>
+        static MappedFile open(const std::string& path, size_t count) {
+
+            MappedFile file(path);
+            if (!file.is_open()) return file;
+
+            bool npy = !file.header.descr.empty();
+            size_t payload = file.count<T>();
+            if (npy && file.header.descr != npy_descr<T>()) {
+                std::cout << "--- [[[ERROR]]] "<<path<<" holds "<<file.header.descr<<" values, expected "<<npy_descr<T>()<<" !!\n";
+                file.unmap();
+            } else if (payload < count || (npy ? file.header.count() != count : payload != count)) {
+                std::cout << "--- [[[ERROR]]] "<<path<<" holds "<<(npy ? file.header.count() : payload)<<" values, expected "<<count<<" !!\n";
+                file.unmap();
+            }
+            return file;
+        }
+
+        // Creates (or truncates) a file holding a matrix of T of the given shape, with a .npy header if path ends with .npy
+        template <typename T>
+        static MappedFile create(const std::string& path, const std::vector<size_t>& shape) {
+
+            MappedFile file(path, true);
+            file.header.descr = npy_descr<T>();
+            file.header.shape = shape;
+            std::string prefix = has_npy_extension(path) ? npy_header(npy_descr<T>(), shape) : std::string();
+            file.header.data_offset = prefix.size();
+
+            file.fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (file.fd < 0) { std::cout << "--- [[[ERROR]]] Cannot create "<<path<<" !!\n"; return file; }
+            size_t bytes = prefix.size()+file.header.count()*sizeof(T);
+            if (ftruncate(file.fd, bytes) != 0) { std::cout << "--- [[[ERROR]]] Cannot resize "<<path<<" !!\n"; return file; }
+            file.map(bytes, PROT_READ | PROT_WRITE);
+            if (file.base != nullptr) std::memcpy(file.base, prefix.data(), prefix.size());
+            return file;
+        }
+
+        MappedFile(MappedFile&& other) noexcept
+            : path(other.path), writable(other.writable), fd(other.fd), base(other.base), map_bytes(other.map_bytes),
+              header(other.header), registered(other.registered), registered_queue(other.registered_queue) {
+            other.fd = -1;
+            other.base = nullptr;
+            other.registered = false;
+        }
+
+        ~MappedFile() {
+            unregister();
+            if (base != nullptr) {
+                if (writable) msync(base, map_bytes, MS_ASYNC);
+                munmap(base, map_bytes);
+            }
+            if (fd >= 0) ::close(fd);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool is_open() const { return base != nullptr; }
+        bool is_registered() const { return registered; }
+        const NpyHeader& info() const { return header; }
+
+        // Payload viewed as T (for a raw file, the number of elements follows from the file size)
+        // nullptr if the file is not mapped or if its .npy descr is not T's
+        template <typename T> T* data() const {
+            if (base == nullptr || (!header.descr.empty() && header.descr != npy_descr<T>())) return nullptr;
+            return reinterpret_cast<T*>((char*)base+header.data_offset);
+        }
+        template <typename T> size_t count() const { return base == nullptr ? 0 : (map_bytes-header.data_offset)/sizeof(T); }
+
+        // Asks the kernel to read ahead [offset, offset+bytes) of the payload (e.g. the next chunk)
+        void prefetch(size_t offset, size_t bytes) const {
+            const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t begin = ((header.data_offset+offset)/page)*page;
+            size_t end = std::min(map_bytes, header.data_offset+offset+bytes);
+            if (begin < end) madvise((char*)base+begin, end-begin, MADV_WILLNEED);
+        }
+
+        // Pins the mapping for direct copies with queue's device, false where the backend cannot
+        bool register_for_device_copy(sycl::queue& queue) {
+            #ifdef SYCL_EXT_ONEAPI_COPY_OPTIMIZE
+            if (base != nullptr && !registered) {
+                try {
+                    sycl::ext::oneapi::experimental::prepare_for_device_copy(base, map_bytes, queue);
+                    registered = true;
+                    registered_queue.emplace(queue);
+                } catch (sycl::exception& e) {
+                    std::cout << "-- [[[WARNING]]] prepare_for_device_copy failed ("<<e.what()<<"), staging through pinned buffers\n";
+                }
+            }
+            #endif
+            return registered;
+        }
+
+        void unregister() {
+            #ifdef SYCL_EXT_ONEAPI_COPY_OPTIMIZE
+            if (registered) sycl::ext::oneapi::experimental::release_from_device_copy(base, *registered_queue);
+            #endif
+            registered = false;
+        }
+
+
+    private:
+        MappedFile(const std::string& path, bool writable) : path(path), writable(writable) {}
+
+        void unmap() {
+            unregister();
+            if (base != nullptr) munmap(base, map_bytes);
+            base = nullptr;
+            map_bytes = 0;
+        }
+
+        void map(size_t bytes, int protection) {
+            void* ptr = bytes > 0 ? mmap(nullptr, bytes, protection, MAP_SHARED, fd, 0) : MAP_FAILED;
+            if (ptr == MAP_FAILED) { std::cout << "--- [[[ERROR]]] Cannot map "<<path<<" !!\n"; return; }
+            base = ptr;
+            map_bytes = bytes;
+        }
+
+        std::string path;
+        bool writable;
+        int fd = -1;
+        void* base = nullptr;
+        size_t map_bytes = 0;
+        NpyHeader header;
+        bool registered = false;
+        std::optional<sycl::queue> registered_queue;
+};
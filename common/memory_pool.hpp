@@ -0,0 +1,229 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <algorithm>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+
+
+/********************************************************
+ *  Caching USM allocator
+ *  - Requests are rounded up to a power-of-two size class (>= 256 bytes)
+ *  - Freed blocks are kept in a per-queue free list instead of being returned with sycl::free
+ *  - A cached device block is reused on the queue it was freed on in stream order (in-order queue);
+ *    host and shared blocks, which the host may touch right away, and blocks of other queues of the
+ *    same context are reused once the event of their last use completed
+ *  - A block freed on a queue recording a command_graph (graph.hpp) is never reused : the graph keeps
+ *    its pointer, so it stays in use until the end of the program
+ ********************************************************/
+
+struct MemoryPoolStats {
+    size_t hits=0;
+    size_t misses=0;
+    size_t bytes_in_use=0;
+    size_t bytes_cached=0;
+    size_t high_water=0;    // peak of bytes held from the SYCL runtime (in use + cached)
+};
+
+
+class MemoryPool {
+
+    public:
+        static MemoryPool& instance() {
+            static MemoryPool pool;
+            return pool;
+        }
+
+        /*** Allocation interface ***/
+        template <typename T>
+        T* malloc_device(size_t count, sycl::queue& queue) { return static_cast<T*>(allocate(count*sizeof(T), sycl::usm::alloc::device, queue)); }
+        template <typename T>
+        T* malloc_shared(size_t count, sycl::queue& queue) { return static_cast<T*>(allocate(count*sizeof(T), sycl::usm::alloc::shared, queue)); }
+        template <typename T>
+        T* malloc_host(size_t count, sycl::queue& queue) { return static_cast<T*>(allocate(count*sizeof(T), sycl::usm::alloc::host, queue)); }
+
+        // Return a block to the free list of the queue. last_use is the event of the last command touching the block
+        void free(void* ptr, sycl::queue& queue, sycl::event last_use=sycl::event()) {
+
+            if (ptr == nullptr) return;
+            std::lock_guard<std::mutex> lock(mutex);
+
+            auto it = in_use.find(ptr);
+            if (it == in_use.end()) {
+                std::cout << "--- [[[ERROR]]] MemoryPool::free on a pointer not allocated by the pool !!\n";
+                return;
+            }
+
+            // Scratch freed while the queue records a command_graph : the graph replays the pointer at every
+            // submission, so the block stays in use rather than being handed out again
+            #ifdef SYCL_EXT_ONEAPI_GRAPH
+            if (queue.ext_oneapi_get_state() == sycl::ext::oneapi::experimental::queue_state::recording) return;
+            #endif
+
+            Block block = it->second;
+            block.last_use = last_use;
+            in_use.erase(it);
+
+            free_list(queue).blocks.push_back(block);
+            counters.bytes_in_use -= block.bytes;
+            counters.bytes_cached += block.bytes;
+        }
+
+        // Give every cached block back to the SYCL runtime (blocks in use are untouched)
+        void release() {
+
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& list : free_lists) {
+                for (auto& block : list.blocks) {
+                    block.last_use.wait();
+                    sycl::free(block.ptr, list.queue);
+                    counters.bytes_cached -= block.bytes;
+                }
+                list.blocks.clear();
+            }
+        }
+
+        MemoryPoolStats stats() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return counters;
+        }
+
+        void print_stats() {
+            MemoryPoolStats s = stats();
+            std::cout << "-- Memory pool : "<<s.hits<<" hits, "<<s.misses<<" misses, "
+                      <<s.bytes_cached/1024.0/1024.0<<" MB cached, "
+                      <<s.high_water/1024.0/1024.0<<" MB high-water mark\n";
+        }
+
+
+    private:
+        struct Block {
+            void* ptr;
+            size_t bytes;
+            sycl::usm::alloc kind;
+            sycl::event last_use;
+        };
+
+        struct FreeList {
+            sycl::queue queue;
+            std::vector<Block> blocks;
+        };
+
+        MemoryPool() {}
+        MemoryPool(const MemoryPool&) = delete;
+        MemoryPool& operator=(const MemoryPool&) = delete;
+
+        static size_t size_class(size_t bytes) {
+            size_t size = 256;
+            while (size < bytes) size <<= 1;
+
+            // Above 1 MB each power of two is split into 8 classes to bound the waste of large buffers
+            if (size > (1<<20)) {
+                size_t step = size/16;
+                size = ((bytes+step-1)/step)*step;
+            }
+            return size;
+        }
+
+        static bool completed(const sycl::event& e) {
+            return e.get_info<sycl::info::event::command_execution_status>() == sycl::info::event_command_status::complete;
+        }
+
+        FreeList& free_list(sycl::queue& queue) {
+            for (auto& list : free_lists) {
+                if (list.queue == queue) return list;
+            }
+            free_lists.push_back(FreeList{queue, {}});
+            return free_lists.back();
+        }
+
+        // Take a cached block out of a free list. Stream-ordered reuse is only legal for device blocks on the same in-order queue
+        bool take_cached(FreeList& list, size_t bytes, sycl::usm::alloc kind, bool stream_ordered, Block& out) {
+            for (size_t i=0; i<list.blocks.size(); i++) {
+                Block& block = list.blocks[i];
+                if (block.bytes != bytes || block.kind != kind) continue;
+                if (!stream_ordered && !completed(block.last_use)) continue;
+
+                out = block;
+                list.blocks[i] = list.blocks.back();
+                list.blocks.pop_back();
+                return true;
+            }
+            return false;
+        }
+
+        void* allocate(size_t requested, sycl::usm::alloc kind, sycl::queue& queue) {
+
+            size_t bytes = size_class(requested);
+            std::lock_guard<std::mutex> lock(mutex);
+
+            // 1. Same queue, 2. any queue of the same context whose last use completed
+            Block block;
+            bool stream_ordered = queue.is_in_order() && kind == sycl::usm::alloc::device;
+            bool found = take_cached(free_list(queue), bytes, kind, stream_ordered, block);
+            for (size_t i=0; !found && i<free_lists.size(); i++) {
+                if (free_lists[i].queue.get_context() == queue.get_context())
+                    found = take_cached(free_lists[i], bytes, kind, false, block);
+            }
+
+            if (found) {
+                counters.hits++;
+                counters.bytes_cached -= block.bytes;
+            } else {
+                counters.misses++;
+                block = Block{sycl::malloc(bytes, queue, kind), bytes, kind, sycl::event()};
+
+                // Out of memory : trim the cache and try once more
+                if (block.ptr == nullptr) {
+                    trim();
+                    block.ptr = sycl::malloc(bytes, queue, kind);
+                    if (block.ptr == nullptr) {
+                        std::cout << "--- [[[ERROR]]] MemoryPool failed to allocate "<<bytes<<" bytes !!\n";
+                        return nullptr;
+                    }
+                }
+            }
+
+            in_use[block.ptr] = block;
+            counters.bytes_in_use += block.bytes;
+            counters.high_water = std::max(counters.high_water, counters.bytes_in_use+counters.bytes_cached);
+            return block.ptr;
+        }
+
+        // Free every cached block whose last use completed (mutex held by the caller)
+        void trim() {
+            for (auto& list : free_lists) {
+                std::vector<Block> pending;
+                for (auto& block : list.blocks) {
+                    if (completed(block.last_use)) {
+                        sycl::free(block.ptr, list.queue);
+                        counters.bytes_cached -= block.bytes;
+                    } else {
+                        pending.push_back(block);
+                    }
+                }
+                list.blocks.swap(pending);
+            }
+        }
+
+        std::mutex mutex;
+        std::vector<FreeList> free_lists;
+        std::unordered_map<void*, Block> in_use;
+        MemoryPoolStats counters;
+};
+
+
+/*** Shorthands used by the primitives ***/
+template <typename T>
+T* pool_malloc_device(size_t count, sycl::queue& queue) { return MemoryPool::instance().malloc_device<T>(count, queue); }
+
+template <typename T>
+T* pool_malloc_shared(size_t count, sycl::queue& queue) { return MemoryPool::instance().malloc_shared<T>(count, queue); }
+
+template <typename T>
+T* pool_malloc_host(size_t count, sycl::queue& queue) { return MemoryPool::instance().malloc_host<T>(count, queue); }
+
+inline void pool_free(void* ptr, sycl::queue& queue, sycl::event last_use=sycl::event()) { MemoryPool::instance().free(ptr, queue, last_use); }
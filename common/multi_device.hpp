@@ -0,0 +1,143 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+#include "memory_pool.hpp"
+
+
+/********************************************************
+ *  Multi-device executor
+ *  - Discovers every visible SYCL device (GPU, CPU, OpenMP host, ...) and keeps a queue per device; a device seen
+ *    through several backends is kept once, from the first platform listing it
+ *  - A calibration microbenchmark gives each device a weight proportional to its throughput
+ *  - A 1D index space is split into weighted partitions, each run by its own host thread
+ *  - The set of visible devices can be narrowed with ONEAPI_DEVICE_SELECTOR / ACPP_VISIBILITY_MASK
+ ********************************************************/
+
+struct DevicePartition {
+    size_t index;       // partition number (= device number among the active devices)
+    size_t begin;
+    size_t end;
+    size_t size() const { return end-begin; }
+};
+
+
+class MultiDeviceExecutor {
+
+    public:
+        MultiDeviceExecutor() {
+            std::map<std::string, std::string> first_platform;
+            for (auto& device : sycl::device::get_devices()) {
+                // The same physical device is listed once per backend (OpenCL, Level-Zero, ...) : a device type and
+                // name is only kept from the first platform listing it, and the SYCL host device is skipped
+                auto type = device.get_info<sycl::info::device::device_type>();
+                if (type == sycl::info::device_type::host) continue;
+                std::string id = std::to_string((int)type)+"|"+device.get_info<sycl::info::device::name>();
+                std::string platform = device.get_platform().get_info<sycl::info::platform::name>();
+                if (first_platform.emplace(id, platform).first->second != platform) continue;
+
+                queues.push_back(sycl::queue(device));
+                weights.push_back(1.0);
+            }
+            active = queues.size();
+        }
+
+        size_t num_devices() const { return queues.size(); }
+        size_t num_active() const { return active; }
+        sycl::queue& queue(size_t d) { return queues[d]; }
+        std::string name(size_t d) const { return queues[d].get_device().get_info<sycl::info::device::name>(); }
+        double weight(size_t d) const { return weights[d]; }
+
+        // Only the first count devices take part in the next partitions (for scaling studies)
+        void use_devices(size_t count) { active = std::max((size_t)1, std::min(count, queues.size())); }
+
+
+        /********************************************************
+         *  Calibration
+         *  - bench(queue) runs a representative piece of work and waits for it
+         *  - Each device is weighted by 1/time of the second (warm) run
+         ********************************************************/
+        template <typename Bench>
+        void calibrate(Bench bench) {
+            for (size_t d=0; d<queues.size(); d++) {
+                bench(queues[d]);
+                auto st = std::chrono::steady_clock::now();
+                bench(queues[d]);
+                double time = std::chrono::duration<double>(std::chrono::steady_clock::now()-st).count();
+                weights[d] = 1.0/std::max(time, 1e-9);
+            }
+        }
+
+        // Default calibration : STREAM-like scale kernel over 64 MB
+        void calibrate() {
+            const size_t count = (64<<20)/sizeof(float);
+            calibrate([count](sycl::queue& queue) {
+                float* data = pool_malloc_device<float>(count, queue);
+                queue.fill(data, 1.0f, count).wait();
+                queue.submit([&] (sycl::handler& cgh) {
+                    cgh.parallel_for(sycl::nd_range<1>(count, 256), [=](sycl::nd_item<1> item) {
+                        size_t x = item.get_global_id(0);
+                        data[x] = data[x]*2.0f+1.0f;
+                    });
+                });
+                queue.wait();
+                pool_free(data, queue);
+            });
+        }
+
+        void print_devices() const {
+            double sum = 0;
+            for (size_t d=0; d<active; d++) sum += weights[d];
+            for (size_t d=0; d<queues.size(); d++) {
+                std::cout << "-- device["<<d<<"] "<<name(d);
+                if (d<active) std::cout << " (weight "<<weights[d]/sum<<")";
+                std::cout << "\n";
+            }
+        }
+
+
+        /********************************************************
+         *  Split [0,total) over the active devices in proportion to their weights
+         *  - Every boundary is a multiple of granularity (except the end of the last partition)
+         ********************************************************/
+        std::vector<DevicePartition> partition(size_t total, size_t granularity=1) const {
+
+            double sum = 0;
+            for (size_t d=0; d<active; d++) sum += weights[d];
+
+            std::vector<DevicePartition> parts;
+            size_t begin = 0;
+            double acc = 0;
+            for (size_t d=0; d<active; d++) {
+                acc += weights[d];
+                size_t end = (d==active-1) ? total : std::min(total, (size_t)(total*acc/sum)/granularity*granularity);
+                parts.push_back(DevicePartition{d, begin, std::max(begin, end)});
+                begin = std::max(begin, end);
+            }
+            return parts;
+        }
+
+        // Run fn(part, queue) for every non-empty partition, one host thread per device
+        template <typename Func>
+        void run(const std::vector<DevicePartition>& parts, Func fn) {
+            std::vector<std::thread> threads;
+            for (auto& part : parts) {
+                if (part.size() == 0) continue;
+                threads.push_back(std::thread([&, part]() { fn(part, queues[part.index]); }));
+            }
+            for (auto& thread : threads) thread.join();
+        }
+
+
+    private:
+        std::vector<sycl::queue> queues;
+        std::vector<double> weights;
+        size_t active;
+};
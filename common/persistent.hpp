@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+#include "memory_pool.hpp"
+
+
+/********************************************************
+ *  Persistent kernels
+ *  - Instead of one work-item per element, a device-sized grid (compute units x occupancy work-groups)
+ *    stays resident and loops over the tiles of the problem
+ *  - grid_stride : work-group g processes tiles g, g+G, g+2G, ... (static, no atomics)
+ *  - work_queue  : after its first tile, a work-group grabs the next tile from a device atomic counter,
+ *    which balances irregular tiles over the work-groups
+ ********************************************************/
+enum class Schedule { launch_per_element, grid_stride, work_queue };
+
+inline const char* schedule_name(Schedule schedule) {
+    switch (schedule) {
+        case Schedule::launch_per_element: return "launch per element";
+        case Schedule::grid_stride:        return "persistent, grid-stride";
+        default:                           return "persistent, atomic work queue";
+    }
+}
+
+// Resident work-groups : groups_per_cu per compute unit (0 = enough groups for 2048 work-items per compute unit)
+inline size_t persistent_groups(sycl::queue& queue, size_t local_size, size_t num_tiles, size_t groups_per_cu=0) {
+    size_t compute_units = queue.get_device().get_info<sycl::info::device::max_compute_units>();
+    if (groups_per_cu == 0) groups_per_cu = std::max((size_t)1, 2048/local_size);
+    return std::max((size_t)1, std::min(num_tiles, compute_units*groups_per_cu));
+}
+
+
+/********************************************************
+ *  Device side tile loop, body(tile) is called by every work-item of the group with the same tile
+ *  - counter == nullptr selects the grid-stride schedule
+ *  - The tile sequence is uniform over the work-group, so body may use group barriers;
+ *    a body reusing local memory across tiles must end with a barrier
+ ********************************************************/
+template <int D, typename Body>
+void persistent_for(const sycl::nd_item<D>& item, const size_t num_tiles, unsigned int* counter, Body body) {
+
+    const size_t num_groups = item.get_group_range().size();
+    size_t tile = item.get_group_linear_id();
+
+    while (tile < num_tiles) {
+        body(tile);
+
+        if (counter == nullptr) {
+            tile += num_groups;
+        } else {
+            size_t next = 0;
+            if (item.get_local_linear_id() == 0) {
+                sycl::atomic_ref<unsigned int, sycl::memory_order::relaxed, sycl::memory_scope::device,
+                                 sycl::access::address_space::global_space> next_tile(*counter);
+                next = num_groups+next_tile.fetch_add(1u);
+            }
+            tile = sycl::group_broadcast(item.get_group(), next, 0);
+        }
+    }
+}
+
+
+/********************************************************
+ *  Host side launch of a persistent kernel
+ *  - submit(handler&, size_t num_groups, unsigned int* counter) declares the local memory and the
+ *    parallel_for over num_groups work-groups, counter is nullptr for the grid-stride schedule
+ *  - The work queue counter comes from the memory pool and is zeroed before the kernel; recorded into a
+ *    command_graph (RecordReplay), every recording keeps its counter allocated for good
+ *    (MemoryPool::free does not reuse blocks freed while recording)
+ ********************************************************/
+template <typename Submit>
+sycl::event persistent_launch(sycl::queue& queue, Schedule schedule, size_t local_size, size_t num_tiles, Submit submit) {
+
+    size_t num_groups = persistent_groups(queue, local_size, num_tiles);
+    if (schedule != Schedule::work_queue) {
+        return queue.submit([&] (sycl::handler& cgh) {
+            submit(cgh, num_groups, (unsigned int*)nullptr);
+        });
+    }
+
+    unsigned int* counter = pool_malloc_device<unsigned int>(1, queue);
+    sycl::event zero = queue.memset(counter, 0, sizeof(unsigned int));
+    sycl::event kernel = queue.submit([&] (sycl::handler& cgh) {
+        cgh.depends_on(zero);
+        submit(cgh, num_groups, counter);
+    });
+    pool_free(counter, queue, kernel);
+    return kernel;
+}
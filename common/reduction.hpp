@@ -0,0 +1,100 @@
+#pragma once
+
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+#include "memory_pool.hpp"
+#include "persistent.hpp"
+
+
+/********************************************************
+ *  Fused transform + reduction
+ *  - transform(i) is evaluated in registers and summed, nothing is written per element,
+ *    so a map followed by a sum reads its input once and writes a single value
+ *  - group_sum : sub-group reduction, one partial per sub-group in local memory, then the first sub-group
+ *    reduces the partials
+ *  - transform_reduce : a device-sized grid (see persistent_groups) strides over [0,count) and writes one
+ *    partial per work-group, a second single work-group launch sums the partials
+ *    (no atomics, so the result is deterministic and any T with + works, e.g. a 64-bit sum of int)
+ ********************************************************/
+template <typename T>
+using ReduceScratch = sycl::accessor<T, 1, sycl::access::mode::read_write, sycl::access::target::local>;
+
+// Sum of value over the work-group, valid on local id 0; scratch holds one value per sub-group.
+// Ends with a barrier, so it can be called again with the same scratch
+template <typename T>
+T group_sum(const sycl::nd_item<1>& item, T value, const ReduceScratch<T>& scratch) {
+
+    sycl::sub_group sg = item.get_sub_group();
+    value = sycl::reduce_over_group(sg, value, sycl::plus<T>());
+    if (sg.get_local_linear_id() == 0)
+        scratch[sg.get_group_linear_id()] = value;
+    item.barrier(sycl::access::fence_space::local_space);
+
+    value = 0;
+    if (sg.get_group_linear_id() == 0) {
+        for (size_t i=sg.get_local_linear_id(); i<sg.get_group_linear_range(); i+=sg.get_local_linear_range())
+            value += scratch[i];
+        value = sycl::reduce_over_group(sg, value, sycl::plus<T>());
+    }
+    item.barrier(sycl::access::fence_space::local_space);
+    return value;
+}
+
+
+/*** Grid-stride sum of transform(i), one partial per work-group ***/
+template <typename T, typename Transform>
+class ReduceFunc {
+
+    public:
+        ReduceFunc(Transform t, size_t n, T* p, ReduceScratch<T> s) : transform(t), count(n), partials(p), scratch(s) {}
+
+        /*** SYCL call interface ***/
+        void operator() (sycl::nd_item<1> item) const {
+            T sum = 0;
+            for (size_t i=item.get_global_id(0); i<count; i+=item.get_global_range(0))
+                sum += transform(i);
+            sum = group_sum(item, sum, scratch);
+            if (item.get_local_id(0) == 0)
+                partials[item.get_group(0)] = sum;
+        }
+
+
+    private:
+        Transform transform;
+        size_t count;
+        T* partials;
+        ReduceScratch<T> scratch;
+};
+
+/*** Transform of the second pass : reads the partials ***/
+template <typename T>
+struct ReduceLoad {
+    const T* values;
+    T operator()(size_t i) const { return values[i]; }
+};
+
+
+/*** *result = sum of transform(i) for i in [0,count) once dependency is done, returns without waiting ***/
+// The partials are per-call pool scratch : recorded into a command_graph (RecordReplay), every recording
+// keeps its partials allocated for good (MemoryPool::free does not reuse blocks freed while recording)
+template <typename T, typename Transform>
+sycl::event transform_reduce(sycl::queue& queue, size_t count, Transform transform, T* result, sycl::event dependency=sycl::event(), size_t local_size=256) {
+
+    size_t num_groups = persistent_groups(queue, local_size, (count+local_size-1)/local_size);
+    T* partials = pool_malloc_device<T>(num_groups, queue);
+
+    sycl::event partial = queue.submit([&] (sycl::handler& cgh) {
+        cgh.depends_on(dependency);
+        ReduceScratch<T> scratch(sycl::range<1>(local_size), cgh);
+        cgh.parallel_for(sycl::nd_range<1>(num_groups*local_size, local_size), ReduceFunc<T, Transform>(transform, count, partials, scratch));
+    });
+
+    sycl::event total = queue.submit([&] (sycl::handler& cgh) {
+        cgh.depends_on(partial);
+        ReduceScratch<T> scratch(sycl::range<1>(local_size), cgh);
+        cgh.parallel_for(sycl::nd_range<1>(local_size, local_size), ReduceFunc<T, ReduceLoad<T>>(ReduceLoad<T>{partials}, num_groups, result, scratch));
+    });
+
+    pool_free(partials, queue, total);
+    return total;
+}
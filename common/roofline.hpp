@@ -0,0 +1,152 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+#include "memory_pool.hpp"
+#include "autotune.hpp"
+
+
+/********************************************************
+ *  Roofline instrumentation
+ *  - Every kernel declares a KernelCost : DRAM bytes read and written and its operation count
+ *  - The roof of a device (STREAM triad bandwidth, multiply-add peak of the dtype) is measured once
+ *  - roofline_report prints arithmetic intensity, % of bandwidth roof and % of compute roof of a run
+ ********************************************************/
+
+struct KernelCost {
+    double bytes_read;
+    double bytes_written;
+    double ops;
+
+    double bytes() const { return bytes_read+bytes_written; }
+    double intensity() const { return bytes()>0 ? ops/bytes() : 0; }
+};
+
+struct DeviceRoof {
+    double bandwidth;   // bytes/s
+    double compute;     // ops/s
+};
+
+
+template <typename T>
+DeviceRoof measure_roof(sycl::queue& queue) {
+
+    static std::mutex mutex;
+    static std::map<std::string, DeviceRoof> roofs;
+
+    std::string key = queue.get_device().get_info<sycl::info::device::name>()+"|"+dtype_name<T>();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = roofs.find(key);
+    if (it != roofs.end()) return it->second;
+
+    const int NUM_RUNS = 5;
+    auto seconds = [](std::chrono::steady_clock::time_point st) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now()-st).count();
+    };
+
+    // Bandwidth roof : STREAM triad a = b + s*c over 3 x 128 MB
+    const size_t count = (128<<20)/sizeof(T);
+    T* a = pool_malloc_device<T>(count, queue);
+    T* b = pool_malloc_device<T>(count, queue);
+    T* c = pool_malloc_device<T>(count, queue);
+    queue.fill(b, (T)1, count);
+    queue.fill(c, (T)2, count);
+    queue.wait();
+
+    double best_triad = 1e30;
+    for (int run=0; run<NUM_RUNS; run++) {
+        auto st = std::chrono::steady_clock::now();
+        queue.submit([&] (sycl::handler& cgh) {
+            cgh.parallel_for(sycl::nd_range<1>(count, 256), [=](sycl::nd_item<1> item) {
+                size_t x = item.get_global_id(0);
+                a[x] = b[x] + (T)3*c[x];
+            });
+        });
+        queue.wait();
+        best_triad = std::min(best_triad, seconds(st));
+    }
+
+    // Compute roof : 16 independent multiply-add chains per workitem
+    // - The factors are loaded from device memory, so the chains cannot be folded at compile time,
+    //   and v*(-1)+1 alternates between v and 1-v, so the values stay bounded for every dtype
+    const size_t items = 1<<20;
+    const int ITERS = 256;
+    T* factors = pool_malloc_device<T>(2, queue);
+    queue.fill(factors, (T)-1, 1);
+    queue.fill(factors+1, (T)1, 1);
+    queue.wait();
+    double best_fma = 1e30;
+    for (int run=0; run<NUM_RUNS; run++) {
+        auto st = std::chrono::steady_clock::now();
+        queue.submit([&] (sycl::handler& cgh) {
+            cgh.parallel_for(sycl::nd_range<1>(items, 256), [=](sycl::nd_item<1> item) {
+                size_t x = item.get_global_id(0);
+                const T mul = factors[0], add = factors[1];
+                T v[16];
+                for (int j=0; j<16; j++) v[j] = (T)(x+j);
+                for (int i=0; i<ITERS; i++)
+                    for (int j=0; j<16; j++) v[j] = v[j]*mul+add;
+                T sum = 0;
+                for (int j=0; j<16; j++) sum += v[j];
+                a[x] = sum;
+            });
+        });
+        queue.wait();
+        best_fma = std::min(best_fma, seconds(st));
+    }
+
+    pool_free(a, queue);
+    pool_free(b, queue);
+    pool_free(c, queue);
+    pool_free(factors, queue);
+
+    DeviceRoof roof{3.0*count*sizeof(T)/best_triad, 2.0*16*ITERS*items/best_fma};
+    std::cout << "-- Roof of "<<queue.get_device().get_info<sycl::info::device::name>()<<" ("<<dtype_name<T>()<<") : "
+              <<roof.bandwidth/1024.0/1024.0/1024.0<<" GB/s, "<<roof.compute/1024.0/1024.0/1024.0<<" Gops\n";
+
+    // Sanity check against the clock : ops per compute unit per cycle, compared with 2 ops (multiply-add) per
+    // lane of at most 4 SIMD units of the widest sub-group per compute unit (Intel EU : 1 x 16 lanes, NVIDIA SM :
+    // 4 x 32, AMD CU : 4 x 16 for wave64); above that the chains were optimized away
+    double compute_units = queue.get_device().get_info<sycl::info::device::max_compute_units>();
+    double clock = queue.get_device().get_info<sycl::info::device::max_clock_frequency>()*1e6;
+    std::vector<size_t> sub_group_sizes = queue.get_device().get_info<sycl::info::device::sub_group_sizes>();
+    double max_lanes = 4.0*(sub_group_sizes.empty() ? 64 : *std::max_element(sub_group_sizes.begin(), sub_group_sizes.end()));
+    if (compute_units > 0 && clock > 0) {
+        double per_cycle = roof.compute/(compute_units*clock);
+        std::cout << "-- Compute roof : "<<per_cycle<<" ops per compute unit per cycle at "<<clock*1e-6<<" MHz\n";
+        if (per_cycle > 2.0*max_lanes)
+            std::cout << "-- [[[WARNING]]] Compute roof above the theoretical peak, the multiply-add chains were not executed as written\n";
+    }
+    roofs[key] = roof;
+    return roof;
+}
+
+
+template <typename T>
+void roofline_report(sycl::queue& queue, const KernelCost& cost, double time) {
+
+    DeviceRoof roof = measure_roof<T>(queue);
+    double bandwidth = cost.bytes()/time;
+    double ops = cost.ops/time;
+    double attainable = std::min(roof.compute, cost.intensity()*roof.bandwidth);
+
+    std::cout << "-- Elasped time : "<<time<<" s\n";
+    std::cout << "-- Effective bandwidth : "<<bandwidth/1024.0/1024.0/1024.0<<" GB/s ("
+              <<100.0*bandwidth/roof.bandwidth<<"% of bandwidth roof)\n";
+    if (cost.ops == 0) {
+        std::cout << "-- Arithmetic intensity : 0 ops/byte, memory bound (data movement only)\n";
+        return;
+    }
+
+    std::cout << "-- Operations per second : "<<ops/1024.0/1024.0/1024.0<<" Gops ("
+              <<100.0*ops/roof.compute<<"% of compute roof)\n";
+    std::cout << "-- Arithmetic intensity : "<<cost.intensity()<<" ops/byte, "
+              <<(cost.intensity()*roof.bandwidth < roof.compute ? "memory" : "compute")<<" bound, "
+              <<100.0*ops/attainable<<"% of attainable "<<attainable/1024.0/1024.0/1024.0<<" Gops\n";
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+#include "memory_pool.hpp"
+
+
+/********************************************************
+ *  Out-of-core streaming engine
+ *  - The input is processed in chunks that fit in device memory
+ *  - Each stream owns an in-order queue, pinned (malloc_host) staging buffers and device buffers
+ *  - Chunk i goes to stream i%num_streams : pack -> H2D -> kernel -> D2H -> unpack,
+ *    so the copies of one stream overlap with the kernels of the others
+ ********************************************************/
+
+// Number of elements moved for one chunk
+// - in_source / out_target : optional host memory the chunk is copied from / to directly instead of the
+//   staging buffers (e.g. a registered memory-mapped file), out_target is then what unpack receives
+struct StreamChunk {
+    size_t in_count;
+    size_t out_count;
+    const void* in_source = nullptr;
+    void* out_target = nullptr;
+};
+
+struct StreamingStats {
+    double wall=0;      // end-to-end time (s)
+    double h2d=0;       // summed device time of each stage (s)
+    double kernel=0;
+    double d2h=0;
+    double host=0;      // pack/unpack between user memory and the pinned staging buffers (s)
+    size_t bytes_in=0;
+    size_t bytes_out=0;
+
+    // Serialized stage time over wall time : 1.0 means no overlap at all
+    double overlap() const { return wall>0 ? (h2d+kernel+d2h)/wall : 0; }
+
+    void print() const {
+        std::cout << "-- Elasped time : "<<wall<<" s\n";
+        std::cout << "-- End-to-end bandwidth : "<<(bytes_in+bytes_out)/1024.0/1024.0/1024.0/wall<<" GB/s\n";
+        std::cout << "-- Stage time : H2D "<<h2d<<" s, kernel "<<kernel<<" s, D2H "<<d2h<<" s, host staging "<<host<<" s\n";
+        std::cout << "-- Achieved overlap : "<<overlap()<<"x (serialized stage time / elapsed time)\n";
+    }
+};
+
+
+template <typename T>
+class StreamingEngine {
+
+    public:
+        // in_capacity/out_capacity : maximum number of elements of a single chunk
+        StreamingEngine(sycl::queue& queue, size_t in_elems, size_t out_elems, size_t num_streams=3)
+            : in_capacity(in_elems), out_capacity(out_elems) {
+
+            for (size_t s=0; s<num_streams; s++) {
+                sycl::queue stream_queue(queue.get_context(), queue.get_device(),
+                                         sycl::property_list{sycl::property::queue::in_order(), sycl::property::queue::enable_profiling()});
+                streams.push_back(Stream{stream_queue,
+                                         pool_malloc_host<T>(in_capacity, stream_queue), pool_malloc_host<T>(out_capacity, stream_queue),
+                                         pool_malloc_device<T>(in_capacity, stream_queue), pool_malloc_device<T>(out_capacity, stream_queue),
+                                         sycl::event(), sycl::event(), sycl::event(), 0, StreamChunk{0, 0}, false});
+            }
+        }
+
+        ~StreamingEngine() {
+            for (auto& stream : streams) {
+                stream.queue.wait();
+                pool_free(stream.host_in, stream.queue);
+                pool_free(stream.host_out, stream.queue);
+                pool_free(stream.device_in, stream.queue);
+                pool_free(stream.device_out, stream.queue);
+            }
+        }
+
+        /********************************************************
+         *  Run the pipeline over num_chunks chunks
+         *  - StreamChunk pack(size_t chunk, T* staging_in)                         : fill the pinned input buffer (or point in_source at the input)
+         *  - sycl::event launch(sycl::queue&, size_t chunk, const T* d_in, T* d_out) : submit the kernel(s) of the chunk
+         *  - void unpack(size_t chunk, const T* staging_out, size_t out_count)      : consume the pinned output buffer
+         ********************************************************/
+        template <typename Pack, typename Launch, typename Unpack>
+        StreamingStats run(size_t num_chunks, Pack pack, Launch launch, Unpack unpack) {
+
+            StreamingStats stats;
+            auto start = std::chrono::steady_clock::now();
+
+            for (size_t chunk=0; chunk<num_chunks; chunk++) {
+
+                Stream& stream = streams[chunk%streams.size()];
+                drain(stream, unpack, stats);
+
+                auto host_start = std::chrono::steady_clock::now();
+                StreamChunk count = pack(chunk, stream.host_in);
+                stats.host += seconds(host_start, std::chrono::steady_clock::now());
+
+                if (count.in_count > in_capacity || count.out_count > out_capacity) {
+                    std::cout << "--- [[[ERROR]]] Streaming chunk "<<chunk<<" exceeds the staging capacity !!\n";
+                    break;
+                }
+
+                const T* source = count.in_source ? static_cast<const T*>(count.in_source) : stream.host_in;
+                T* target = count.out_target ? static_cast<T*>(count.out_target) : stream.host_out;
+                stream.h2d = stream.queue.memcpy(stream.device_in, source, count.in_count*sizeof(T));
+                stream.kernel = launch(stream.queue, chunk, stream.device_in, stream.device_out);
+                stream.d2h = stream.queue.memcpy(target, stream.device_out, count.out_count*sizeof(T));
+                stream.chunk = chunk;
+                stream.count = count;
+                stream.busy = true;
+
+                stats.bytes_in += count.in_count*sizeof(T);
+                stats.bytes_out += count.out_count*sizeof(T);
+            }
+
+            for (auto& stream : streams)
+                drain(stream, unpack, stats);
+
+            stats.wall = seconds(start, std::chrono::steady_clock::now());
+            return stats;
+        }
+
+
+    private:
+        struct Stream {
+            sycl::queue queue;
+            T* host_in;
+            T* host_out;
+            T* device_in;
+            T* device_out;
+            sycl::event h2d;
+            sycl::event kernel;
+            sycl::event d2h;
+            size_t chunk;
+            StreamChunk count;
+            bool busy;
+        };
+
+        static double seconds(std::chrono::steady_clock::time_point st, std::chrono::steady_clock::time_point ed) {
+            return std::chrono::duration<double>(ed-st).count();
+        }
+
+        static double device_time(const sycl::event& e) {
+            auto st = e.get_profiling_info<sycl::info::event_profiling::command_start>();
+            auto ed = e.get_profiling_info<sycl::info::event_profiling::command_end>();
+            return (ed-st)*1e-9;
+        }
+
+        // Wait for the previous chunk of the stream and hand its result to the user
+        template <typename Unpack>
+        void drain(Stream& stream, Unpack& unpack, StreamingStats& stats) {
+
+            if (!stream.busy) return;
+            stream.d2h.wait();
+
+            stats.h2d += device_time(stream.h2d);
+            stats.kernel += device_time(stream.kernel);
+            stats.d2h += device_time(stream.d2h);
+
+            auto host_start = std::chrono::steady_clock::now();
+            const T* result = stream.count.out_target ? static_cast<const T*>(stream.count.out_target) : stream.host_out;
+            unpack(stream.chunk, result, stream.count.out_count);
+            stats.host += seconds(host_start, std::chrono::steady_clock::now());
+
+            stream.busy = false;
+        }
+
+        size_t in_capacity;
+        size_t out_capacity;
+        std::vector<Stream> streams;
+};
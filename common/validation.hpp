@@ -0,0 +1,208 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+
+/********************************************************
+ *  Host-side validation
+ *  - parallel_for_blocks : splits [0,n) over all hardware threads
+ *  - validate / validate_sampled : full or randomized spot-check comparison against a reference function
+ *  - Integers are compared exactly, floating point values within max_ulps (or abs_tol around zero)
+ *  - matmul_freivalds : probabilistic O(n^2) check of C = A*B, matmul_reference : cache-blocked threaded O(n^3)
+ ********************************************************/
+
+struct ValidationTolerance {
+    int64_t max_ulps = 4;
+    double abs_tol = 1e-6;
+};
+
+
+template <typename Func>
+void parallel_for_blocks(size_t n, Func func) {
+
+    size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min(num_threads, std::max((size_t)1, n));
+    size_t block = (n+num_threads-1)/num_threads;
+
+    std::vector<std::thread> threads;
+    for (size_t t=0; t<num_threads; t++) {
+        size_t begin = t*block, end = std::min(n, begin+block);
+        if (begin >= end) break;
+        threads.push_back(std::thread([=, &func]() { func(begin, end); }));
+    }
+    for (auto& thread : threads) thread.join();
+}
+
+
+// Distance in units in the last place between two finite floating point values
+template <typename T>
+int64_t ulp_distance(T a, T b) {
+
+    using Bits = typename std::conditional<sizeof(T)==4, int32_t, int64_t>::type;
+    Bits ia, ib;
+    std::memcpy(&ia, &a, sizeof(T));
+    std::memcpy(&ib, &b, sizeof(T));
+
+    // Map the sign-magnitude representation onto a monotonic integer line
+    if (ia < 0) ia = std::numeric_limits<Bits>::min() - ia;
+    if (ib < 0) ib = std::numeric_limits<Bits>::min() - ib;
+    return ia>ib ? (int64_t)ia-(int64_t)ib : (int64_t)ib-(int64_t)ia;
+}
+
+template <typename T>
+bool values_equal(T expected, T actual, const ValidationTolerance& tol) {
+
+    if constexpr (std::is_floating_point<T>::value) {
+        if (std::isnan(expected) || std::isnan(actual)) return std::isnan(expected) && std::isnan(actual);
+        if (std::fabs((double)expected-(double)actual) <= tol.abs_tol) return true;
+        return ulp_distance(expected, actual) <= tol.max_ulps;
+    } else {
+        return expected == actual;
+    }
+}
+
+template <typename T>
+void report_mismatch(size_t index, size_t cols, T expected, T actual) {
+    std::cout << "--- [[[ERROR]]] Checking the result failed at [";
+    if (cols > 0) std::cout << index/cols << "," << index%cols;
+    else std::cout << index;
+    std::cout << "], gt("<<expected<<") != result("<<actual<<") !!\n";
+}
+
+
+/********************************************************
+ *  Compare actual[0..n) with reference(i), on all threads
+ *  - cols > 0 prints the failing index as [row,col]
+ *  - Reports the first failing index
+ ********************************************************/
+template <typename T, typename Reference>
+bool validate(size_t n, Reference reference, const T* actual, size_t cols=0, ValidationTolerance tol=ValidationTolerance()) {
+
+    std::atomic<size_t> first_error(n);
+    parallel_for_blocks(n, [&](size_t begin, size_t end) {
+        for (size_t i=begin; i<end && i<first_error.load(std::memory_order_relaxed); i++) {
+            if (!values_equal<T>(reference(i), actual[i], tol)) {
+                size_t current = first_error.load();
+                while (i < current && !first_error.compare_exchange_weak(current, i)) {}
+                return;
+            }
+        }
+    });
+
+    if (first_error.load() < n) {
+        size_t i = first_error.load();
+        report_mismatch<T>(i, cols, reference(i), actual[i]);
+        return false;
+    }
+
+    std::cout << "--- Checking the result succeed!!\n";
+    return true;
+}
+
+// Randomized spot check of num_samples indices (useful when reference(i) is expensive)
+template <typename T, typename Reference>
+bool validate_sampled(size_t n, size_t num_samples, Reference reference, const T* actual, size_t cols=0, ValidationTolerance tol=ValidationTolerance(), unsigned seed=2022) {
+
+    std::vector<size_t> samples(num_samples);
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> dist(0, n-1);
+    for (auto& s : samples) s = dist(rng);
+
+    std::atomic<size_t> error_sample(num_samples);
+    parallel_for_blocks(num_samples, [&](size_t begin, size_t end) {
+        for (size_t s=begin; s<end; s++) {
+            if (!values_equal<T>(reference(samples[s]), actual[samples[s]], tol)) {
+                error_sample.store(s);
+                return;
+            }
+        }
+    });
+
+    if (error_sample.load() < num_samples) {
+        size_t i = samples[error_sample.load()];
+        report_mismatch<T>(i, cols, reference(i), actual[i]);
+        return false;
+    }
+
+    std::cout << "--- Checking the result succeed!! ("<<num_samples<<" random samples)\n";
+    return true;
+}
+
+
+/********************************************************
+ *  Freivalds' check of C[M,N] = A[M,K] * B[K,N]
+ *  - Each round draws r in {0,1}^N and compares A*(B*r) with C*r in O(MK+KN+MN)
+ *  - A wrong C passes a round with probability <= 1/2, so rounds=20 gives < 1e-6
+ ********************************************************/
+template <typename T>
+bool matmul_freivalds(const T* A, const T* B, const T* C, size_t M, size_t N, size_t K, int rounds=20, ValidationTolerance tol=ValidationTolerance(), unsigned seed=2022) {
+
+    std::mt19937 rng(seed);
+    std::vector<T> r(N), Br(K), ABr(M), Cr(M);
+
+    for (int round=0; round<rounds; round++) {
+
+        for (auto& v : r) v = (T)(rng()&1);
+
+        parallel_for_blocks(K, [&](size_t begin, size_t end) {
+            for (size_t k=begin; k<end; k++) {
+                T sum = 0;
+                for (size_t n=0; n<N; n++) sum += B[k*N+n]*r[n];
+                Br[k] = sum;
+            }
+        });
+
+        parallel_for_blocks(M, [&](size_t begin, size_t end) {
+            for (size_t m=begin; m<end; m++) {
+                T sum_ab = 0, sum_c = 0;
+                for (size_t k=0; k<K; k++) sum_ab += A[m*K+k]*Br[k];
+                for (size_t n=0; n<N; n++) sum_c += C[m*N+n]*r[n];
+                ABr[m] = sum_ab;
+                Cr[m] = sum_c;
+            }
+        });
+
+        // Floating point rows accumulate N rounding errors, so the ULP budget grows with the row length
+        ValidationTolerance row_tol = tol;
+        row_tol.max_ulps = tol.max_ulps*(int64_t)std::max(N, K);
+        for (size_t m=0; m<M; m++) {
+            if (!values_equal<T>(ABr[m], Cr[m], row_tol)) {
+                std::cout << "--- [[[ERROR]]] Freivalds check failed at row "<<m<<" in round "<<round<<", (A*B*r)("<<ABr[m]<<") != (C*r)("<<Cr[m]<<") !!\n";
+                return false;
+            }
+        }
+    }
+
+    std::cout << "--- Checking the result succeed!! (Freivalds, "<<rounds<<" rounds)\n";
+    return true;
+}
+
+// Cache-blocked, threaded reference C = A*B (rows of C are spread over the threads)
+template <typename T>
+void matmul_reference(const T* A, const T* B, T* C, size_t M, size_t N, size_t K, size_t block=64) {
+
+    parallel_for_blocks(M, [&](size_t begin, size_t end) {
+        for (size_t m=begin; m<end; m++)
+            for (size_t n=0; n<N; n++) C[m*N+n] = 0;
+
+        for (size_t m0=begin; m0<end; m0+=block)
+        for (size_t k0=0; k0<K; k0+=block)
+        for (size_t n0=0; n0<N; n0+=block)
+            for (size_t m=m0; m<std::min(end, m0+block); m++)
+                for (size_t k=k0; k<std::min(K, k0+block); k++) {
+                    T a = A[m*K+k];
+                    for (size_t n=n0; n<std::min(N, n0+block); n++)
+                        C[m*N+n] += a*B[k*N+n];
+                }
+    });
+}
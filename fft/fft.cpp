@@ -0,0 +1,147 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+#include "../common/memory_pool.hpp"
+#include "../common/device_select.hpp"
+#include "../common/roofline.hpp"
+#include "../common/validation.hpp"
+
+/*** Measure performance ***/
+#include <sys/time.h>
+#define ELAPSED_TIME(st, ed) ((ed.tv_sec - st.tv_sec) + ((ed.tv_usec-st.tv_usec)*1e-6))
+timeval start, end;
+
+/*** Data configuration ***/
+#define DTYPE float
+#ifdef __MODE_SMALL_PROBLEM__
+const std::vector<size_t> SIZES = {1024, 1200};    // 2^10 (radix 4) and 2^4*3*5^2 (mixed radix)
+#else
+const std::vector<size_t> SIZES = {4096, 4800};    // 2^12 (radix 4) and 2^6*3*5^2 (mixed radix)
+#endif
+
+/*** Debugging info ***/
+#define __MODE_DEBUG_TIME__
+const int NUM_TESTS=10;
+const size_t NUM_SAMPLES=64;
+
+/*** Parallel algorithm implementations ***/
+#include "includes/fft_2d.hpp"
+void check_result(const std::vector<Complex<DTYPE>>&, const std::vector<Complex<DTYPE>>&, const std::vector<Complex<DTYPE>>&, size_t, size_t);
+
+
+/********************************************************
+ *  Time the forward 2D FFT of a random [rows,cols] complex matrix and check the spectrum and the round trip
+ ********************************************************/
+void run_fft_2d(sycl::queue& queue, const size_t rows, const size_t cols) {
+
+    std::cout << "\n2D FFT ["<<rows<<","<<cols<<"] (radices";
+    for (int radix : fft_radices(cols)) std::cout << " "<<radix;
+    std::cout << ")\n";
+
+    const size_t count = rows*cols;
+    std::vector<Complex<DTYPE>> in(count), spectrum(count), out(count);
+    std::generate(in.begin(), in.end(), [](){ return Complex<DTYPE>{(DTYPE)std::rand()/RAND_MAX, (DTYPE)std::rand()/RAND_MAX}; });
+
+    FFT2D<DTYPE> fft(queue, rows, cols);
+    sycl::queue& stream = fft.queue();
+    Complex<DTYPE>* device_data = pool_malloc_device<Complex<DTYPE>>(count, stream);
+
+    stream.memcpy(device_data, in.data(), count*sizeof(Complex<DTYPE>));
+    fft.forward(device_data).wait();    // warming up
+    gettimeofday(&start, NULL);
+    for (int test=0; test<NUM_TESTS; test++){
+        fft.forward(device_data).wait();
+    }
+    gettimeofday(&end, NULL);
+    roofline_report<DTYPE>(queue, fft_2d_cost<DTYPE>(rows, cols), ELAPSED_TIME(start, end)/NUM_TESTS);
+
+    #ifdef __MODE_DEBUG_TIME__
+    stream.memcpy(device_data, in.data(), count*sizeof(Complex<DTYPE>));
+    fft.forward(device_data);
+    stream.memcpy(spectrum.data(), device_data, count*sizeof(Complex<DTYPE>));
+    fft.inverse(device_data);
+    stream.memcpy(out.data(), device_data, count*sizeof(Complex<DTYPE>));
+    stream.wait();
+    check_result(in, spectrum, out, rows, cols);
+    #endif
+
+    pool_free(device_data, stream);
+}
+
+
+int main(int argc, char* argv[]) {
+
+    std::cout << "=================================================\n";
+    std::cout << "SYCL Primitives : 2D FFT\n";
+    std::cout << "-- a single device example (--device=<gpu|cpu|acc|index|name>)\n";
+    std::cout << "-- Forward 2D FFT of a complex matrix, mixed radix 2, 3, 4, 5\n";
+    std::cout << "=================================================\n\n";
+
+    /********************************************************
+     *  SYCL setup
+     ********************************************************/
+    sycl::queue queue(select_device(argc, argv));
+    std::cout << "Running on "<<queue.get_device().get_info<sycl::info::device::name>()<<"\n";
+    measure_roof<DTYPE>(queue);    // one-time bandwidth and compute roof of the device
+
+
+    /********************************************************
+     *  Power of two and mixed radix sizes
+     ********************************************************/
+    for (size_t n : SIZES) {
+        run_fft_2d(queue, n, n);
+    }
+
+
+
+    MemoryPool::instance().print_stats();
+    MemoryPool::instance().release();
+    return 0;
+}
+
+
+
+void check_result(const std::vector<Complex<DTYPE>>& in, const std::vector<Complex<DTYPE>>& spectrum, const std::vector<Complex<DTYPE>>& out,
+                  size_t rows, size_t cols) {
+
+    const size_t count = rows*cols;
+    const double PI = 3.14159265358979323846;
+    const double log_n = std::log2((double)count);
+
+    // Spectrum : entry [v,u] of the transposed layout against a direct DFT in double, re and im interleaved
+    std::vector<double> cos_rows(rows), sin_rows(rows), cos_cols(cols), sin_cols(cols);
+    for (size_t k=0; k<rows; k++) { cos_rows[k] = std::cos(2*PI*k/rows); sin_rows[k] = -std::sin(2*PI*k/rows); }
+    for (size_t k=0; k<cols; k++) { cos_cols[k] = std::cos(2*PI*k/cols); sin_cols[k] = -std::sin(2*PI*k/cols); }
+    auto reference = [&](size_t i) {
+        size_t v = (i/2)/rows, u = (i/2)%rows;
+        double re = 0, im = 0;
+        for (size_t y=0; y<rows; y++) {
+            double row_re = 0, row_im = 0;
+            for (size_t x=0; x<cols; x++) {
+                size_t k = (v*x)%cols;
+                row_re += in[y*cols+x].re*cos_cols[k]-in[y*cols+x].im*sin_cols[k];
+                row_im += in[y*cols+x].re*sin_cols[k]+in[y*cols+x].im*cos_cols[k];
+            }
+            size_t k = (u*y)%rows;
+            re += row_re*cos_rows[k]-row_im*sin_rows[k];
+            im += row_re*sin_rows[k]+row_im*cos_rows[k];
+        }
+        return (DTYPE)(i%2 == 0 ? re : im);
+    };
+    ValidationTolerance spectrum_tol;
+    spectrum_tol.abs_tol = 1e-6*std::sqrt((double)count)*log_n;    // float rounding grows with the norm of the input and the number of passes
+    validate_sampled(2*count, NUM_SAMPLES, reference, &spectrum[0].re, rows, spectrum_tol);
+
+    // Round trip : inverse(forward(in))/(rows*cols) == in
+    std::vector<DTYPE> scaled(2*count);
+    for (size_t i=0; i<count; i++) {
+        scaled[2*i] = out[i].re/count;
+        scaled[2*i+1] = out[i].im/count;
+    }
+    ValidationTolerance round_trip_tol;
+    round_trip_tol.abs_tol = 1e-6*log_n;
+    validate(2*count, [&](size_t i) { return i%2 == 0 ? in[i/2].re : in[i/2].im; }, scaled.data(), 2*cols, round_trip_tol);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+
+
+/*** Complex value of the FFT kernels (interleaved re, im) ***/
+template <typename R>
+struct Complex {
+    R re;
+    R im;
+};
+
+template <typename R> inline Complex<R> operator+(const Complex<R> a, const Complex<R> b) { return Complex<R>{a.re+b.re, a.im+b.im}; }
+template <typename R> inline Complex<R> operator-(const Complex<R> a, const Complex<R> b) { return Complex<R>{a.re-b.re, a.im-b.im}; }
+template <typename R> inline Complex<R> operator*(const Complex<R> a, const Complex<R> b) { return Complex<R>{a.re*b.re-a.im*b.im, a.re*b.im+a.im*b.re}; }
+
+
+/********************************************************
+ *  Mixed-radix factorization : n = 4^a 2^b 3^c 5^d
+ *  - Radix-4 passes first (fewest passes), then 2, 3 and 5
+ *  - fft_good_size : smallest such size >= n, used to pad without going to the next power of two
+ ********************************************************/
+inline std::vector<int> fft_radices(size_t n) {
+    std::vector<int> radices;
+    while (n%4 == 0) { radices.push_back(4); n /= 4; }
+    while (n%2 == 0) { radices.push_back(2); n /= 2; }
+    while (n%3 == 0) { radices.push_back(3); n /= 3; }
+    while (n%5 == 0) { radices.push_back(5); n /= 5; }
+    if (n != 1) radices.clear();
+    return radices;
+}
+
+inline bool fft_supported_size(size_t n) {
+    return n == 1 || !fft_radices(n).empty();
+}
+
+inline size_t fft_good_size(size_t n) {
+    while (!fft_supported_size(n)) n++;
+    return n;
+}
+
+
+/*** In-register DFT of RADIX values, sign -1 forward, +1 inverse ***/
+template <int RADIX, typename R>
+inline void fft_butterfly(Complex<R>* v, const int sign) {
+
+    if constexpr (RADIX == 2) {
+        Complex<R> a = v[0], b = v[1];
+        v[0] = a+b;
+        v[1] = a-b;
+    } else if constexpr (RADIX == 4) {
+        Complex<R> s02 = v[0]+v[2], d02 = v[0]-v[2];
+        Complex<R> s13 = v[1]+v[3], d13 = v[1]-v[3];
+        Complex<R> rot = Complex<R>{-sign*d13.im, sign*d13.re};    // sign*i*(v1-v3)
+        v[0] = s02+s13;
+        v[1] = d02+rot;
+        v[2] = s02-s13;
+        v[3] = d02-rot;
+    } else {
+        const R PI = (R)3.14159265358979323846;
+        Complex<R> w[RADIX], x[RADIX];
+        for (int m=0; m<RADIX; m++)
+            w[m] = Complex<R>{sycl::cos(2*PI*m/RADIX), sign*sycl::sin(2*PI*m/RADIX)};
+        for (int k=0; k<RADIX; k++) {
+            x[k] = v[0];
+            for (int r=1; r<RADIX; r++) x[k] = x[k]+v[r]*w[(r*k)%RADIX];
+        }
+        for (int k=0; k<RADIX; k++) v[k] = x[k];
+    }
+}
+
+
+/********************************************************
+ *  One Stockham pass of radix RADIX over the rows of in [batch, n], written to out
+ *  - Ns is the product of the radices of the previous passes
+ *  - Butterfly j reads the RADIX values n/RADIX apart, so the output comes out in natural order
+ ********************************************************/
+template <typename R, int RADIX>
+sycl::event fft_pass(sycl::queue& queue, const Complex<R>* in, Complex<R>* out, const size_t batch, const size_t n, const size_t Ns, const int sign) {
+
+    const size_t butterflies = n/RADIX;
+    const size_t total = batch*butterflies;
+
+    return queue.submit([&] (sycl::handler& cgh) {
+        cgh.parallel_for(sycl::nd_range<1>(((total+255)/256)*256, 256), [=](sycl::nd_item<1> item) {
+
+            size_t id = item.get_global_id(0);
+            if (id >= total) return;
+
+            size_t b = id/butterflies;
+            size_t j = id%butterflies;
+            const Complex<R>* row_in = in+b*n;
+            Complex<R>* row_out = out+b*n;
+
+            const R PI = (R)3.14159265358979323846;
+            R angle = sign*2*PI*(R)(j%Ns)/(R)(Ns*RADIX);
+
+            Complex<R> v[RADIX];
+            for (int r=0; r<RADIX; r++)
+                v[r] = row_in[j+r*butterflies]*Complex<R>{sycl::cos(r*angle), sycl::sin(r*angle)};
+
+            fft_butterfly<RADIX>(v, sign);
+
+            size_t idx = (j/Ns)*Ns*RADIX+(j%Ns);
+            for (int r=0; r<RADIX; r++)
+                row_out[idx+r*Ns] = v[r];
+        });
+    });
+}
+
+
+/********************************************************
+ *  Batched 1D FFT of the rows of data [batch, n] (n = 2^a 3^b 5^c), sign -1 forward, +1 inverse (unscaled)
+ *  - The passes ping-pong between data and work, the returned pointer is the buffer holding the result
+ *  - last is set to the event of the last pass (unchanged for n == 1)
+ *  - queue must be in-order : the passes are not chained by events
+ ********************************************************/
+template <typename R>
+Complex<R>* fft_rows(sycl::queue& queue, Complex<R>* data, Complex<R>* work, const size_t batch, const size_t n, const int sign, sycl::event& last) {
+
+    Complex<R>* src = data;
+    Complex<R>* dst = work;
+    size_t Ns = 1;
+    for (int radix : fft_radices(n)) {
+        switch (radix) {
+            case 4:  last = fft_pass<R, 4>(queue, src, dst, batch, n, Ns, sign); break;
+            case 2:  last = fft_pass<R, 2>(queue, src, dst, batch, n, Ns, sign); break;
+            case 3:  last = fft_pass<R, 3>(queue, src, dst, batch, n, Ns, sign); break;
+            default: last = fft_pass<R, 5>(queue, src, dst, batch, n, Ns, sign); break;
+        }
+        std::swap(src, dst);
+        Ns *= radix;
+    }
+    return src;
+}
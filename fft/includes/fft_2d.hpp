@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cmath>
+#include "../../common/memory_pool.hpp"
+#include "../../common/roofline.hpp"
+#include "../../transpose/includes/transpose_coalesced.hpp"
+#include "fft.hpp"
+
+
+/*** Roofline cost of a 2D FFT : every pass and the transpose read and write the whole matrix, 5 N log2 N flops ***/
+template <typename R>
+KernelCost fft_2d_cost(const size_t rows, const size_t cols) {
+    double passes = (double)fft_radices(rows).size()+fft_radices(cols).size()+1;
+    double bytes = passes*sizeof(Complex<R>)*rows*cols;
+    return KernelCost{bytes, bytes, 5.0*rows*cols*std::log2((double)rows*cols)};
+}
+
+
+/********************************************************
+ *  2D FFT of a [rows, cols] complex matrix (rows, cols = 2^a 3^b 5^c)
+ *  - Row pass, coalesced tiled transpose, row pass : both passes read contiguous rows
+ *  - forward leaves the spectrum transposed ([cols, rows]), inverse takes it back to [rows, cols],
+ *    which saves the second transpose of each direction when the spectrum is only multiplied pointwise
+ *  - inverse is unscaled (the caller folds 1/(rows*cols) into its pointwise step)
+ *  - The work buffer is allocated once, all the work goes to an in-order queue of the device
+ ********************************************************/
+template <typename R>
+class FFT2D {
+
+    public:
+        FFT2D(sycl::queue& queue, size_t rows, size_t cols)
+            : stream(queue.get_context(), queue.get_device(), sycl::property_list{sycl::property::queue::in_order()}),
+              rows(rows), cols(cols) {
+            work = pool_malloc_device<Complex<R>>(rows*cols, stream);
+        }
+
+        ~FFT2D() {
+            stream.wait();
+            pool_free(work, stream);
+        }
+
+        FFT2D(const FFT2D&) = delete;
+        FFT2D& operator=(const FFT2D&) = delete;
+
+        sycl::queue& queue() { return stream; }
+
+        // data [rows, cols] -> spectrum [cols, rows], in place
+        sycl::event forward(Complex<R>* data) {
+            return run(data, rows, cols, -1);
+        }
+
+        // spectrum [cols, rows] -> data [rows, cols], in place and unscaled
+        sycl::event inverse(Complex<R>* data) {
+            return run(data, cols, rows, 1);
+        }
+
+
+    private:
+        sycl::event run(Complex<R>* data, size_t in_rows, size_t in_cols, int sign) {
+
+            sycl::event last;
+            Complex<R>* result = fft_rows(stream, data, work, in_rows, in_cols, sign, last);
+            Complex<R>* other = result == data ? work : data;
+            last = transpose_coalesced<Complex<R>>(stream, result, other, in_rows, in_cols);
+            result = fft_rows(stream, other, result, in_cols, in_rows, sign, last);
+            if (result != data)
+                last = stream.memcpy(data, result, sizeof(Complex<R>)*rows*cols);
+            return last;
+        }
+
+        sycl::queue stream;
+        size_t rows, cols;
+        Complex<R>* work;
+};
@@ -1,9 +1,203 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <mutex>
 #include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+#include "../common/memory_pool.hpp"
+#include "../common/device_select.hpp"
+#include "../common/roofline.hpp"
+#include "../common/validation.hpp"
 
+/*** Measure performance ***/
+#include <sys/time.h>
+#define ELAPSED_TIME(st, ed) ((ed.tv_sec - st.tv_sec) + ((ed.tv_usec-st.tv_usec)*1e-6))
+timeval start, end;
 
-int main(void) {
+/*** Data configuration ***/
+#ifdef __MODE_SMALL_PROBLEM__
+constexpr size_t NUM_DATA = 1<<24;
+constexpr size_t IMAGE_SIZE = 1024*2;    // RGBA image : IMAGE_SIZE x IMAGE_SIZE x 4 = NUM_DATA values
+#else
+constexpr size_t NUM_DATA = 1<<28;
+constexpr size_t IMAGE_SIZE = 1024*8;
+#endif
+constexpr int MAX_KEY = 1<<16;
+const std::vector<int> BIN_COUNTS = {256, 1024, 4096, 16384, 65536};
 
+/*** Debugging info ***/
+#define __MODE_DEBUG_TIME__
+const int NUM_TESTS=10;
+template <int CHANNELS, typename T, typename Binning>
+void check_result(const std::vector<T>&, size_t, size_t, const Binning&, const T*, const std::vector<unsigned int>&);
+
+/*** Parallel algorithm implementations ***/
+#include "includes/histogram_segmented.hpp"
+
+
+/********************************************************
+ *  Time histogram_segmented over in and check it
+ *  - host_bounds are the boundaries of binning on the host (nullptr for even bins)
+ ********************************************************/
+template <int CHANNELS, typename T, typename Binning>
+void run_histogram(sycl::queue& queue, const std::vector<T>& in, const T* device_in, size_t num_segments, size_t segment_size,
+                   const Binning& binning, const T* host_bounds) {
+
+    const size_t num_counters = num_segments*CHANNELS*binning.num_bins;
+    std::vector<unsigned int> hist(num_counters);
+    unsigned int* device_hist = pool_malloc_device<unsigned int>(num_counters, queue);
+
+    std::cout << "- "<<binning.num_bins<<" bins ("
+              <<(histogram_fits_local<CHANNELS, T>(queue, binning) ? "local memory" : "global memory privatized")<<")\n";
+
+    histogram_segmented<CHANNELS>(queue, device_in, num_segments, segment_size, binning, device_hist).wait();    // warming up
+    gettimeofday(&start, NULL);
+    for (int test=0; test<NUM_TESTS; test++){
+        histogram_segmented<CHANNELS>(queue, device_in, num_segments, segment_size, binning, device_hist).wait();
+    }
+    gettimeofday(&end, NULL);
+    roofline_report<T>(queue, histogram_cost<T>(num_segments*segment_size*CHANNELS, num_counters), ELAPSED_TIME(start, end)/NUM_TESTS);
+
+    #ifdef __MODE_DEBUG_TIME__
+    queue.memcpy(hist.data(), device_hist, num_counters*sizeof(unsigned int));
+    queue.wait();
+    check_result<CHANNELS>(in, num_segments, segment_size, binning, host_bounds, hist);
+    #endif
+
+    pool_free(device_hist, queue);
+}
+
+
+/********************************************************
+ *  Main Function
+ ********************************************************/
+int main(int argc, char* argv[]) {
+
+    std::cout << "=================================================\n";
+    std::cout << "SYCL Primitives : Parallel Histogram\n";
+    std::cout << "-- a single device example (--device=<gpu|cpu|acc|index|name>)\n";
+    std::cout << "-- 1D keys : in["<<NUM_DATA<<"] -> hist[bins], "<<BIN_COUNTS.front()<<" to "<<BIN_COUNTS.back()<<" bins\n";
+    std::cout << "-- RGBA image : in["<<IMAGE_SIZE<<","<<IMAGE_SIZE<<",4] -> hist["<<IMAGE_SIZE<<",4,bins], one histogram per row\n";
+    std::cout << "-- 1D key size: "<<sizeof(int)*NUM_DATA/1024.0/1024.0/1024.0<<" GB\n";
+    std::cout << "=================================================\n\n";
+
+    /********************************************************
+     *  SYCL setup
+     ********************************************************/
+    sycl::queue queue(select_device(argc, argv));
+    std::cout << "Running on "<<queue.get_device().get_info<sycl::info::device::name>()<<"\n";
+    std::cout << "-- local memory : "<<queue.get_device().get_info<sycl::info::device::local_mem_size>()/1024.0<<" KB\n";
+    measure_roof<int>(queue);      // one-time bandwidth and compute roof of the device
+    measure_roof<float>(queue);
+
+    /********************************************************
+     *  Data initilzation
+     ********************************************************/
+    // Integer keys in [0, MAX_KEY)
+    std::vector<int> int_keys(NUM_DATA);
+    std::generate(int_keys.begin(), int_keys.end(), [](){return std::rand()%MAX_KEY;});
+    int* device_int_keys = pool_malloc_device<int>(NUM_DATA, queue);
+    queue.memcpy(device_int_keys, int_keys.data(), NUM_DATA*sizeof(int));
+
+    // Float keys in [0, 1)
+    std::vector<float> float_keys(NUM_DATA);
+    std::generate(float_keys.begin(), float_keys.end(), [](){return (float)(std::rand()%MAX_KEY)/MAX_KEY+0.5f/MAX_KEY;});
+    float* device_float_keys = pool_malloc_device<float>(NUM_DATA, queue);
+    queue.memcpy(device_float_keys, float_keys.data(), NUM_DATA*sizeof(float));
+
+    // RGBA pixels, every channel in [0, 256)
+    std::vector<int> image(IMAGE_SIZE*IMAGE_SIZE*4);
+    std::generate(image.begin(), image.end(), [](){return std::rand()%256;});
+    int* device_image = pool_malloc_device<int>(image.size(), queue);
+    queue.memcpy(device_image, image.data(), image.size()*sizeof(int));
+    queue.wait();
+
+
+    /********************************************************
+     *  Even bins, integer keys
+     ********************************************************/
+    std::cout << "\nHistogram with even bins over [0,"<<MAX_KEY<<"), int keys\n";
+    for (int bins : BIN_COUNTS) {
+        run_histogram<1>(queue, int_keys, device_int_keys, 1, NUM_DATA, EvenBins<int>{0, MAX_KEY, bins}, (const int*)nullptr);
+    }
+
+
+    /********************************************************
+     *  Even bins, float keys
+     ********************************************************/
+    std::cout << "\nHistogram with even bins over [0,1), float keys\n";
+    for (int bins : BIN_COUNTS) {
+        run_histogram<1>(queue, float_keys, device_float_keys, 1, NUM_DATA, EvenBins<float>{0.0f, 1.0f, bins}, (const float*)nullptr);
+    }
+
+
+    /********************************************************
+     *  Arbitrary boundaries, float keys
+     *  - Quadratically spaced boundaries (b/bins)^2, the bin is found by a binary search
+     ********************************************************/
+    std::cout << "\nHistogram with arbitrary bin boundaries over [0,1), float keys\n";
+    for (int bins : BIN_COUNTS) {
+        std::vector<float> bounds(bins+1);
+        for (int b=0; b<=bins; b++) bounds[b] = (float)b/bins*(float)b/bins;
+        float* device_bounds = pool_malloc_device<float>(bins+1, queue);
+        queue.memcpy(device_bounds, bounds.data(), (bins+1)*sizeof(float)).wait();
+
+        run_histogram<1>(queue, float_keys, device_float_keys, 1, NUM_DATA, RangeBins<float>{device_bounds, bins}, bounds.data());
+        pool_free(device_bounds, queue);
+    }
+
+
+    /********************************************************
+     *  Segmented RGBA histogram : one 4-channel histogram per image row
+     ********************************************************/
+    std::cout << "\nSegmented RGBA histogram ("<<IMAGE_SIZE<<" rows of "<<IMAGE_SIZE<<" pixels)\n";
+    for (int bins : {16, 256}) {
+        run_histogram<4>(queue, image, device_image, IMAGE_SIZE, IMAGE_SIZE, EvenBins<int>{0, 256, bins}, (const int*)nullptr);
+    }
+
+
+    /********************************************************
+     *  Finalize
+     ********************************************************/
+    pool_free(device_int_keys, queue);
+    pool_free(device_float_keys, queue);
+    pool_free(device_image, queue);
+    MemoryPool::instance().print_stats();
+    MemoryPool::instance().release();
     return 0;
-}
\ No newline at end of file
+}
+
+template <int CHANNELS, typename T, typename Binning>
+void check_result(const std::vector<T>& in, size_t num_segments, size_t segment_size, const Binning& binning, const T* bounds,
+                  const std::vector<unsigned int>& hist) {
+
+    const size_t num_bins = binning.num_bins;
+    const size_t hist_size = CHANNELS*num_bins;
+    std::vector<unsigned int> gt(num_segments*hist_size, 0);
+
+    auto count = [&](size_t s, size_t begin, size_t end, unsigned int* segment_hist) {
+        for (size_t p=begin; p<end; p++) {
+            for (int c=0; c<CHANNELS; c++) {
+                int bin = binning(in[(s*segment_size+p)*CHANNELS+c], bounds);
+                if (bin >= 0) segment_hist[c*num_bins+bin]++;
+            }
+        }
+    };
+
+    // Many segments are spread over the threads, a single one is split into thread-private histograms
+    if (num_segments > 1) {
+        parallel_for_blocks(num_segments, [&](size_t begin, size_t end) {
+            for (size_t s=begin; s<end; s++) count(s, 0, segment_size, gt.data()+s*hist_size);
+        });
+    } else {
+        std::mutex mutex;
+        parallel_for_blocks(segment_size, [&](size_t begin, size_t end) {
+            std::vector<unsigned int> local(hist_size, 0);
+            count(0, begin, end, local.data());
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t b=0; b<hist_size; b++) gt[b] += local[b];
+        });
+    }
+
+    validate(gt.size(), [&](size_t i) { return gt[i]; }, hist.data(), num_bins);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <type_traits>
+
+
+/********************************************************
+ *  Binning functions : bin = binning(value, bounds), -1 for values outside of every bin
+ *  - bounds is the boundary array as seen by the kernel (local memory copy, global or host pointer)
+ *  - num_boundaries() elements of boundaries() are staged in local memory by the local memory kernel
+ ********************************************************/
+
+/*** Even bins : num_bins bins of width (upper-lower)/num_bins over [lower, upper) ***/
+template <typename T>
+struct EvenBins {
+    T lower;
+    T upper;
+    int num_bins;
+
+    size_t num_boundaries() const { return 0; }
+    const T* boundaries() const { return nullptr; }
+
+    template <typename Bounds>
+    int operator()(const T value, const Bounds&) const {
+        if (!(value >= lower && value < upper))
+            return -1;
+
+        if constexpr (std::is_integral<T>::value) {
+            return (int)(((long)(value-lower)*num_bins)/((long)upper-(long)lower));
+        } else {
+            int bin = (int)((value-lower)*(num_bins/(upper-lower)));
+            return bin < num_bins ? bin : num_bins-1;
+        }
+    }
+};
+
+
+/*** Arbitrary bins : bin b is [bounds[b], bounds[b+1]), num_bins+1 ascending boundaries in device memory ***/
+template <typename T>
+struct RangeBins {
+    const T* bounds;
+    int num_bins;
+
+    size_t num_boundaries() const { return num_bins+1; }
+    const T* boundaries() const { return bounds; }
+
+    // Binary search for bounds[lo] <= value < bounds[lo+1]
+    template <typename Bounds>
+    int operator()(const T value, const Bounds& b) const {
+        if (!(value >= b[0] && value < b[num_bins]))
+            return -1;
+
+        int lo = 0, hi = num_bins;
+        while (hi-lo > 1) {
+            int mid = (lo+hi)/2;
+            if (value < b[mid]) hi = mid;
+            else lo = mid;
+        }
+        return lo;
+    }
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../../common/memory_pool.hpp"
+#include "histogram_binning.hpp"
+
+
+/********************************************************
+ *  Histogram privatized in global memory (bin counts that do not fit in local memory)
+ *  - Same layout as histogram_local_memory
+ *  - Every segment gets copies private histograms in global memory, work-group g counts into copy g%copies,
+ *    which spreads the atomic traffic of a hot bin over several addresses
+ *  - A second kernel sums the copies into hist, the binary search reads the boundaries from global memory
+ ********************************************************/
+template <int CHANNELS, typename T, typename Binning>
+sycl::event histogram_global_privatized(sycl::queue& queue, const T* in, const size_t num_segments, const size_t segment_size, const Binning binning,
+                                        unsigned int* hist, const size_t groups_per_segment, const size_t copies, const size_t local_size=256) {
+
+    const size_t num_bins = binning.num_bins;
+    const size_t hist_size = CHANNELS*num_bins;
+    const T* bounds = binning.boundaries();
+
+    unsigned int* private_hists = pool_malloc_device<unsigned int>(num_segments*copies*hist_size, queue);
+    sycl::event zero = queue.memset(private_hists, 0, sizeof(unsigned int)*num_segments*copies*hist_size);
+
+    sycl::event count = queue.submit([&] (sycl::handler& cgh) {
+
+        cgh.depends_on(zero);
+        cgh.parallel_for(sycl::nd_range<2>({num_segments, groups_per_segment*local_size}, {1, local_size}), [=](sycl::nd_item<2> item) {
+
+            size_t s = item.get_global_id(0);
+            size_t g = item.get_group(1);
+            unsigned int* private_hist = private_hists+(s*copies+g%copies)*hist_size;
+
+            const T* segment = in+s*segment_size*CHANNELS;
+            size_t stride = item.get_global_range(1);
+            for (size_t p=item.get_global_id(1); p<segment_size; p+=stride) {
+                for (int c=0; c<CHANNELS; c++) {
+                    int bin = binning(segment[p*CHANNELS+c], bounds);
+                    if (bin >= 0) {
+                        sycl::atomic_ref<unsigned int, sycl::memory_order::relaxed, sycl::memory_scope::device,
+                                         sycl::access::address_space::global_space> counter(private_hist[c*num_bins+bin]);
+                        counter.fetch_add(1u);
+                    }
+                }
+            }
+        });
+    });
+
+    const size_t total = num_segments*hist_size;
+    sycl::event reduce = queue.submit([&] (sycl::handler& cgh) {
+
+        cgh.depends_on(count);
+        cgh.parallel_for(sycl::nd_range<1>(((total+255)/256)*256, 256), [=](sycl::nd_item<1> item) {
+
+            size_t x = item.get_global_id(0);
+            if (x >= total) return;
+
+            size_t s = x/hist_size;
+            size_t b = x%hist_size;
+            unsigned int sum = 0;
+            for (size_t copy=0; copy<copies; copy++)
+                sum += private_hists[(s*copies+copy)*hist_size+b];
+            hist[x] = sum;
+        });
+    });
+
+    pool_free(private_hists, queue, reduce);
+    return reduce;
+}
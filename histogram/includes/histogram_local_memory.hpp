@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include "histogram_binning.hpp"
+
+
+/********************************************************
+ *  Histogram privatized in local memory
+ *  - in : num_segments segments of segment_size pixels, CHANNELS interleaved values per pixel
+ *  - hist : [num_segments][CHANNELS][num_bins] counters, zeroed here
+ *  - groups_per_segment work-groups stride over a segment, each counts into its local copy with
+ *    work-group atomics and flushes the non-zero counters to hist with device atomics
+ *  - The bin boundaries (if any) are staged in local memory for the binary search
+ ********************************************************/
+template <int CHANNELS, typename T, typename Binning>
+sycl::event histogram_local_memory(sycl::queue& queue, const T* in, const size_t num_segments, const size_t segment_size, const Binning binning,
+                                   unsigned int* hist, const size_t groups_per_segment, const size_t local_size=256) {
+
+    const size_t num_bins = binning.num_bins;
+    const size_t hist_size = CHANNELS*num_bins;
+    const size_t num_bounds = binning.num_boundaries();
+    const T* bounds = binning.boundaries();
+
+    sycl::event zero = queue.memset(hist, 0, sizeof(unsigned int)*num_segments*hist_size);
+
+    return queue.submit([&] (sycl::handler& cgh) {
+
+        cgh.depends_on(zero);
+        sycl::accessor<unsigned int, 1, sycl::access::mode::read_write, sycl::access::target::local> local_hist(sycl::range<1>(hist_size), cgh);
+        sycl::accessor<T, 1, sycl::access::mode::read_write, sycl::access::target::local> local_bounds(sycl::range<1>(std::max((size_t)1, num_bounds)), cgh);
+        cgh.parallel_for(sycl::nd_range<2>({num_segments, groups_per_segment*local_size}, {1, local_size}), [=](sycl::nd_item<2> item) {
+
+            size_t s = item.get_global_id(0);
+            size_t lid = item.get_local_id(1);
+
+            for (size_t b=lid; b<hist_size; b+=local_size)
+                local_hist[b] = 0;
+            for (size_t b=lid; b<num_bounds; b+=local_size)
+                local_bounds[b] = bounds[b];
+            item.barrier(sycl::access::fence_space::local_space);
+
+            const T* segment = in+s*segment_size*CHANNELS;
+            size_t stride = item.get_global_range(1);
+            for (size_t p=item.get_global_id(1); p<segment_size; p+=stride) {
+                for (int c=0; c<CHANNELS; c++) {
+                    int bin = binning(segment[p*CHANNELS+c], local_bounds);
+                    if (bin >= 0) {
+                        sycl::atomic_ref<unsigned int, sycl::memory_order::relaxed, sycl::memory_scope::work_group,
+                                         sycl::access::address_space::local_space> counter(local_hist[c*num_bins+bin]);
+                        counter.fetch_add(1u);
+                    }
+                }
+            }
+            item.barrier(sycl::access::fence_space::local_space);
+
+            unsigned int* segment_hist = hist+s*hist_size;
+            for (size_t b=lid; b<hist_size; b+=local_size) {
+                unsigned int count = local_hist[b];
+                if (count > 0) {
+                    sycl::atomic_ref<unsigned int, sycl::memory_order::relaxed, sycl::memory_scope::device,
+                                     sycl::access::address_space::global_space> counter(segment_hist[b]);
+                    counter.fetch_add(count);
+                }
+            }
+        });
+    });
+}
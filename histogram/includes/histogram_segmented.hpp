@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include "../../common/roofline.hpp"
+#include "histogram_binning.hpp"
+#include "histogram_local_memory.hpp"
+#include "histogram_global_privatized.hpp"
+
+
+/*** Roofline cost : every value is read and binned once, every counter written once ***/
+template <typename T>
+KernelCost histogram_cost(const size_t num_values, const size_t num_counters) {
+    return KernelCost{(double)sizeof(T)*num_values, (double)sizeof(unsigned int)*num_counters, (double)num_values};
+}
+
+// The local memory kernel allocates the CHANNELS x num_bins counters and the boundaries (at least one element)
+// of a work-group; HISTOGRAM_LOCAL_HEADROOM bytes stay free for what the runtime reserves itself
+constexpr size_t HISTOGRAM_LOCAL_HEADROOM = 1024;
+
+template <int CHANNELS, typename T, typename Binning>
+bool histogram_fits_local(sycl::queue& queue, const Binning& binning) {
+    size_t local_mem = queue.get_device().get_info<sycl::info::device::local_mem_size>();
+    size_t bytes = sizeof(unsigned int)*CHANNELS*binning.num_bins+sizeof(T)*std::max((size_t)1, binning.num_boundaries());
+    return bytes+HISTOGRAM_LOCAL_HEADROOM <= local_mem;
+}
+
+
+/********************************************************
+ *  Segmented multi-channel histogram
+ *  - hist[s][c][b] counts the values of channel c of segment s (a row, an image, ...) that fall in bin b
+ *  - About 8 work-groups per compute unit are spread over the segments
+ *  - Local memory privatization when the counters fit, global memory privatization otherwise
+ *    (at most 64 MB of private copies)
+ ********************************************************/
+template <int CHANNELS, typename T, typename Binning>
+sycl::event histogram_segmented(sycl::queue& queue, const T* in, const size_t num_segments, const size_t segment_size, const Binning binning,
+                                unsigned int* hist, const size_t local_size=256) {
+
+    size_t compute_units = queue.get_device().get_info<sycl::info::device::max_compute_units>();
+    size_t max_groups = std::max((size_t)1, (segment_size+local_size-1)/local_size);
+    size_t groups_per_segment = std::min(max_groups, std::max((size_t)1, (8*compute_units+num_segments-1)/num_segments));
+
+    if (histogram_fits_local<CHANNELS, T>(queue, binning))
+        return histogram_local_memory<CHANNELS>(queue, in, num_segments, segment_size, binning, hist, groups_per_segment, local_size);
+
+    size_t hist_size = CHANNELS*binning.num_bins;
+    size_t budget = std::max((size_t)1, (64<<20)/sizeof(unsigned int)/(num_segments*hist_size));
+    size_t copies = std::min({groups_per_segment, compute_units, budget});
+    return histogram_global_privatized<CHANNELS>(queue, in, num_segments, segment_size, binning, hist, groups_per_segment, copies, local_size);
+}
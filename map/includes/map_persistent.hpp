@@ -0,0 +1,67 @@
+#ifndef __JH_MAP_PERSISTENT__
+#define __JH_MAP_PERSISTENT__
+
+#include "../../common/persistent.hpp"
+
+
+/*** A tile is local_size*WORK_PER_ITEM consecutive elements, each workitem strides over it by local_size ***/
+class MapFuncPersistent {
+
+    public:
+        MapFuncPersistent() : device_in(nullptr), device_out(nullptr), count(0), num_tiles(0), counter(nullptr) {}
+        MapFuncPersistent(const DTYPE* d_in, DTYPE* d_out, size_t n, size_t tiles, unsigned int* c)
+            : device_in(d_in), device_out(d_out), count(n), num_tiles(tiles), counter(c) {}
+
+        /*** SYCL call interface ***/
+        void operator() (sycl::nd_item<1> item) const {
+            size_t local_size = item.get_local_range(0);
+            size_t lx = item.get_local_id(0);
+            persistent_for(item, num_tiles, counter, [&](size_t tile) {
+                size_t base = tile*local_size*WORK_PER_ITEM+lx;
+                for (int i=0; i<WORK_PER_ITEM; i++) {
+                    if (base+i*local_size < count)
+                        device_out[base+i*local_size] = map(device_in[base+i*local_size]);
+                }
+            });
+        }
+
+
+    private:
+        const DTYPE* device_in;
+        DTYPE* device_out;
+        size_t count;
+        size_t num_tiles;
+        unsigned int* counter;
+
+};
+
+
+/*** Map over count elements with a device-sized grid, returns without waiting ***/
+sycl::event map_persistent(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out, size_t count, Schedule schedule, size_t local_size=1024) {
+
+    size_t num_tiles = (count+local_size*WORK_PER_ITEM-1)/(local_size*WORK_PER_ITEM);
+    return persistent_launch(queue, schedule, local_size, num_tiles, [&](sycl::handler& cgh, size_t num_groups, unsigned int* counter) {
+        cgh.parallel_for(sycl::nd_range<1>(num_groups*local_size, local_size), MapFuncPersistent(device_in, device_out, count, num_tiles, counter));
+    });
+}
+
+/*** Launch-per-element baseline of the same size : one workitem per element ***/
+sycl::event map_per_element(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out, size_t count, size_t local_size=1024) {
+
+    return queue.submit([&] (sycl::handler& cgh) {
+        cgh.parallel_for(sycl::nd_range<1>(((count+local_size-1)/local_size)*local_size, local_size), [=](sycl::nd_item<1> item) {
+            size_t x = item.get_global_id(0);
+            if (x < count)
+                device_out[x] = map(device_in[x]);
+        });
+    });
+}
+
+sycl::event map_schedule(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out, size_t count, Schedule schedule) {
+
+    if (schedule == Schedule::launch_per_element)
+        return map_per_element(queue, device_in, device_out, count);
+    return map_persistent(queue, device_in, device_out, count, schedule);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef __JH_MAP_RANGE__
+#define __JH_MAP_RANGE__
+
+
+class MapFuncRange {
+
+    public:
+        MapFuncRange() : device_in(nullptr), device_out(nullptr), count(0) {}
+        MapFuncRange(const DTYPE* d_in, DTYPE* d_out, size_t n) : device_in(d_in), device_out(d_out), count(n) {}
+
+        /*** SYCL call interface ***/
+        void operator() (sycl::nd_item<1> item) const {
+            size_t x = item.get_global_id();
+            size_t size = item.get_global_range()[0];
+            for (int i=0; i<WORK_PER_ITEM; i++) {
+                if (x+i*size < count)
+                    device_out[x+i*size] = map(device_in[x+i*size]);
+            }
+        }
+        
+
+    private:
+        const DTYPE* device_in;
+        DTYPE* device_out;
+        size_t count;
+
+};
+
+
+/*** Map over an arbitrary number of elements, returns without waiting (used by the chunked drivers) ***/
+sycl::event map_range(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out, size_t count) {
+
+    size_t num_items = (count+WORK_PER_ITEM-1)/WORK_PER_ITEM;
+    size_t global_size = ((num_items+1023)/1024)*1024;
+
+    return queue.submit([&] (sycl::handler& cgh) {
+        cgh.parallel_for(sycl::nd_range<1>(global_size, 1024), MapFuncRange(device_in, device_out, count));
+    });
+}
+
+#endif
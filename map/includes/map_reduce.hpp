@@ -0,0 +1,68 @@
+#ifndef __JH_MAP_REDUCE__
+#define __JH_MAP_REDUCE__
+
+#include "../../common/reduction.hpp"
+#include "map_range.hpp"
+
+
+/*** Transform of the fused map + sum : map(in[i]) widened to the accumulator type T ***/
+template <typename T>
+class MapFuncReduce {
+
+    public:
+        MapFuncReduce() : device_in(nullptr) {}
+        MapFuncReduce(const DTYPE* d_in) : device_in(d_in) {}
+
+        T operator() (size_t i) const {
+            return (T)map(device_in[i]);
+        }
+
+
+    private:
+        const DTYPE* device_in;
+
+};
+
+/*** Transform of the unfused baseline : the already mapped value ***/
+template <typename T>
+class MapFuncLoad {
+
+    public:
+        MapFuncLoad() : device_in(nullptr) {}
+        MapFuncLoad(const DTYPE* d_in) : device_in(d_in) {}
+
+        T operator() (size_t i) const {
+            return (T)device_in[i];
+        }
+
+
+    private:
+        const DTYPE* device_in;
+
+};
+
+
+/*** Roofline costs : the fused version reads in once and writes nothing per element, the baseline also writes and reads back out ***/
+KernelCost map_reduce_cost(size_t count) {
+    return KernelCost{(double)sizeof(DTYPE)*count, 0, (double)(OPS_PER_ITEM+1)*count};
+}
+
+KernelCost map_then_reduce_cost(size_t count) {
+    return KernelCost{2.0*sizeof(DTYPE)*count, (double)sizeof(DTYPE)*count, (double)(OPS_PER_ITEM+1)*count};
+}
+
+
+/*** *result = sum of map(in[i]) in a single pass, returns without waiting ***/
+template <typename T>
+sycl::event map_reduce(sycl::queue& queue, const DTYPE* device_in, size_t count, T* result) {
+    return transform_reduce(queue, count, MapFuncReduce<T>(device_in), result);
+}
+
+/*** Baseline : map into device_out, then sum device_out (in read, out written and read again) ***/
+template <typename T>
+sycl::event map_then_reduce(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out, size_t count, T* result) {
+    sycl::event mapped = map_range(queue, device_in, device_out, count);
+    return transform_reduce(queue, count, MapFuncLoad<T>(device_out), result, mapped);
+}
+
+#endif
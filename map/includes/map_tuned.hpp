@@ -0,0 +1,71 @@
+#ifndef __JH_MAP_TUNED__
+#define __JH_MAP_TUNED__
+
+#include "../../common/autotune.hpp"
+
+
+template <int WPI>
+class MapFuncTuned {
+
+    public:
+        MapFuncTuned() : device_in(nullptr), device_out(nullptr), count(0) {}
+        MapFuncTuned(const DTYPE* d_in, DTYPE* d_out, size_t n) : device_in(d_in), device_out(d_out), count(n) {}
+
+        /*** SYCL call interface ***/
+        void operator() (sycl::nd_item<1> item) const {
+            size_t x = item.get_global_id();
+            size_t size = item.get_global_range()[0];
+            for (int i=0; i<WPI; i++) {
+                if (x+i*size < count)
+                    device_out[x+i*size] = map(device_in[x+i*size]);
+            }
+        }
+
+
+    private:
+        const DTYPE* device_in;
+        DTYPE* device_out;
+        size_t count;
+
+};
+
+
+template <int WPI>
+sycl::event map_tuned(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out, size_t count, size_t local_size) {
+
+    size_t num_items = (count+WPI-1)/WPI;
+    size_t global_size = ((num_items+local_size-1)/local_size)*local_size;
+
+    return queue.submit([&] (sycl::handler& cgh) {
+        cgh.parallel_for(sycl::nd_range<1>(global_size, local_size), MapFuncTuned<WPI>(device_in, device_out, count));
+    });
+}
+
+
+/*** Tuned configuration : {work per item, local size} ***/
+sycl::event map_dispatch(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out, size_t count, const TuningConfig& config) {
+
+    switch (config[0]) {
+        case 1:  return map_tuned<1>(queue, device_in, device_out, count, config[1]);
+        case 2:  return map_tuned<2>(queue, device_in, device_out, count, config[1]);
+        case 4:  return map_tuned<4>(queue, device_in, device_out, count, config[1]);
+        case 8:  return map_tuned<8>(queue, device_in, device_out, count, config[1]);
+        default: return map_tuned<16>(queue, device_in, device_out, count, config[1]);
+    }
+}
+
+void map_auto(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out, size_t count) {
+
+    size_t max_local = queue.get_device().get_info<sycl::info::device::max_work_group_size>();
+    auto space = tuning_space({{1, 2, 4, 8, 16}, {128, 256, 512, 1024}},
+                              [&](const TuningConfig& c) { return (size_t)c[1] <= max_local; });
+
+    TuningConfig config = autotune(tuning_key<DTYPE>("map", queue, count), space, [&](const TuningConfig& c) {
+        map_dispatch(queue, device_in, device_out, count, c).wait();
+    });
+
+    map_dispatch(queue, device_in, device_out, count, config);
+    queue.wait();
+}
+
+#endif
@@ -4,6 +4,10 @@
 #include <cstring>
 #include <CL/sycl.hpp>
 namespace sycl=cl::sycl;
+#include "../common/memory_pool.hpp"
+#include "../common/device_select.hpp"
+#include "../common/roofline.hpp"
+#include "../common/validation.hpp"
 
 /*** Measure performance ***/
 #include <sys/time.h>
@@ -12,9 +16,20 @@ timeval start, end;
 
 /*** Data configuration ***/
 #define DTYPE int
+#ifdef __MODE_SMALL_PROBLEM__
+constexpr size_t NUM_DATA = 1<<26;
+#else
 constexpr size_t NUM_DATA = 1<<29;
+#endif
 #define WORK_PER_ITEM 8
 
+/*** Streaming configuration ***/
+const size_t NUM_STREAM_CHUNKS=16;
+const size_t NUM_STREAMS=3;
+
+/*** Record and replay configuration ***/
+const int NUM_REPLAYS=200;
+
 /*** Debugging info ***/
 #define __MODE_DEBUG_TIME__
 const size_t NUM_TESTS=20;
@@ -26,22 +41,35 @@ void check_result(const std::vector<DTYPE>&,const std::vector<DTYPE>&);
 inline DTYPE map(const DTYPE in) {
     return in*in-in/8+in*in*4-in*3;
 }
-const int OPS_PER_ITEM = 1;
+const int OPS_PER_ITEM = 8;    // 4 mul, 1 div, 3 add/sub
+
+/*** Roofline cost shared by the map implementations : read in, write out ***/
+KernelCost map_cost(size_t count) {
+    return KernelCost{(double)sizeof(DTYPE)*count, (double)sizeof(DTYPE)*count, (double)OPS_PER_ITEM*count};
+}
 
 
 /*** Map inplementation ***/
 #include "includes/map_naive.hpp"
 #include "includes/map_work_intensive.hpp"
 #include "includes/map_work_intensive_unrolled.hpp"
+#include "includes/map_range.hpp"
+#include "includes/map_tuned.hpp"
+#include "includes/map_persistent.hpp"
+#include "includes/map_reduce.hpp"
+#include "../common/streaming.hpp"
+#include "../common/mapped_file.hpp"
+#include "../common/multi_device.hpp"
+#include "../common/graph.hpp"
 
 /********************************************************
  *  Main Function
  ********************************************************/
-int main(void) {
+int main(int argc, char* argv[]) {
 
     std::cout << "=================================================\n";
     std::cout << "SYCL Primitives : Parallel Map\n";
-    std::cout << "-- a single nvidia GPU example\n";
+    std::cout << "-- a single device example (--device=<gpu|cpu|acc|index|name>)\n";
     std::cout << "-- 1D vector map opertaion : in["<<NUM_DATA<<"] -> "<<"out["<<NUM_DATA<<"]\n";
     std::cout << "-- 1D vector size: "<<sizeof(DTYPE)*NUM_DATA/1024.0/1024.0/1024.0<<" GB\n";
     std::cout << "-- test environment : NVIDIA RTX 2060 super (bandwidth: 448.0 GB/s)\n";
@@ -50,8 +78,9 @@ int main(void) {
     /********************************************************
      *  SYCL setup
      ********************************************************/
-    sycl::gpu_selector device;
-    sycl::queue queue(device);
+    sycl::queue queue(select_device(argc, argv));
+    std::cout << "Running on "<<queue.get_device().get_info<sycl::info::device::name>()<<"\n";
+    measure_roof<DTYPE>(queue);    // one-time bandwidth and compute roof of the device
 
     /********************************************************
      *  Data initilzation
@@ -59,13 +88,13 @@ int main(void) {
     // Input data
     std::vector<DTYPE> in(NUM_DATA);
     std::generate(in.begin(), in.end(), [](){return std::rand()%100-50;});
-    DTYPE* device_in = sycl::malloc_device<DTYPE>(NUM_DATA, queue);
+    DTYPE* device_in = pool_malloc_device<DTYPE>(NUM_DATA, queue);
     queue.memcpy(device_in, in.data(), NUM_DATA*sizeof(DTYPE));
     queue.wait();
 
     // Output data
     std::vector<DTYPE> out(NUM_DATA);
-    DTYPE* device_out = sycl::malloc_device<DTYPE>(NUM_DATA, queue);
+    DTYPE* device_out = pool_malloc_device<DTYPE>(NUM_DATA, queue);
 
     // For initial warming up
     map_naive(queue, device_in, device_out); 
@@ -82,9 +111,7 @@ int main(void) {
         map_naive(queue, device_in, device_out);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*NUM_DATA/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
-    std::cout << "-- Operations per second : "<<OPS_PER_ITEM*NUM_DATA/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" Gops\n";
+    roofline_report<DTYPE>(queue, map_cost(NUM_DATA), ELAPSED_TIME(start, end)/NUM_TESTS);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(out.data(), device_out, NUM_DATA*sizeof(DTYPE));
@@ -103,9 +130,7 @@ int main(void) {
         map_work_intensive(queue, device_in, device_out);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*NUM_DATA/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
-    std::cout << "-- Operations per second : "<<OPS_PER_ITEM*NUM_DATA/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" Gops\n";
+    roofline_report<DTYPE>(queue, map_cost(NUM_DATA), ELAPSED_TIME(start, end)/NUM_TESTS);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(out.data(), device_out, NUM_DATA*sizeof(DTYPE));
@@ -124,9 +149,28 @@ int main(void) {
         map_work_intensive_unrolled(queue, device_in, device_out);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*NUM_DATA/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
-    std::cout << "-- Operations per second : "<<OPS_PER_ITEM*NUM_DATA/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" Gops\n";
+    roofline_report<DTYPE>(queue, map_cost(NUM_DATA), ELAPSED_TIME(start, end)/NUM_TESTS);
+
+    #ifdef __MODE_DEBUG_TIME__
+    queue.memcpy(out.data(), device_out, NUM_DATA*sizeof(DTYPE));
+    queue.wait();
+    check_result(in, out);
+    std::memset(out.data(), 0, sizeof(DTYPE)*out.size());
+    queue.memset(device_out, 0, NUM_DATA*sizeof(DTYPE));
+    #endif
+
+
+    /********************************************************
+     *  Auto-tuned implementation : {work per item, local size}
+     ********************************************************/
+    std::cout << "\nAuto-tuned parallel map operation (tuning cache : "<<TuningCache::instance().file()<<")\n";
+    map_auto(queue, device_in, device_out, NUM_DATA);    // tunes on the first call, then reads the cache
+    gettimeofday(&start, NULL);
+    for (int test=0; test<NUM_TESTS; test++){
+        map_auto(queue, device_in, device_out, NUM_DATA);
+    }
+    gettimeofday(&end, NULL);
+    roofline_report<DTYPE>(queue, map_cost(NUM_DATA), ELAPSED_TIME(start, end)/NUM_TESTS);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(out.data(), device_out, NUM_DATA*sizeof(DTYPE));
@@ -137,22 +181,307 @@ int main(void) {
     #endif
 
 
+    /********************************************************
+     *  Persistent kernel vs launch per element across problem sizes
+     *  - The persistent grid has compute units x occupancy work-groups, whatever the problem size
+     ********************************************************/
+    std::cout << "\nPersistent map (device-sized grid) vs launch per element\n";
+    for (size_t count : {NUM_DATA>>12, NUM_DATA>>8, NUM_DATA>>4, NUM_DATA}) {
+        std::cout << "- "<<count<<" elements\n";
+        for (Schedule schedule : {Schedule::launch_per_element, Schedule::grid_stride, Schedule::work_queue}) {
+            map_schedule(queue, device_in, device_out, count, schedule).wait();    // warming up
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++){
+                map_schedule(queue, device_in, device_out, count, schedule).wait();
+            }
+            gettimeofday(&end, NULL);
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            std::cout << "-- "<<schedule_name(schedule)<<" : "<<time<<" s, "<<map_cost(count).bytes()/1024.0/1024.0/1024.0/time<<" GB/s\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            if (count == NUM_DATA) {
+                queue.memcpy(out.data(), device_out, NUM_DATA*sizeof(DTYPE));
+                queue.wait();
+                check_result(in, out);
+                queue.memset(device_out, 0, NUM_DATA*sizeof(DTYPE));
+                queue.wait();
+            }
+            #endif
+        }
+    }
+
+
+    /********************************************************
+     *  Fused map + sum vs map then sum
+     *  - The sum is accumulated in 64 bits, the fused version never writes the mapped values
+     ********************************************************/
+    std::cout << "\nFused map + sum (transform_reduce) vs map then sum\n";
+    {
+        long long result = 0;
+        long long* device_result = pool_malloc_device<long long>(1, queue);
+
+        #ifdef __MODE_DEBUG_TIME__
+        std::atomic<long long> reference(0);
+        parallel_for_blocks(NUM_DATA, [&](size_t begin, size_t end) {
+            long long sum = 0;
+            for (size_t i=begin; i<end; i++) sum += map(in[i]);
+            reference += sum;
+        });
+        #endif
+
+        double fused_time = 0;
+        for (bool fused : {true, false}) {
+            auto run = [&]() {
+                if (fused) return map_reduce(queue, device_in, NUM_DATA, device_result);
+                return map_then_reduce(queue, device_in, device_out, NUM_DATA, device_result);
+            };
+            run().wait();    // warming up
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++){
+                run().wait();
+            }
+            gettimeofday(&end, NULL);
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            if (fused) fused_time = time;
+            std::cout << "- "<<(fused ? "fused transform_reduce" : "map then sum")<<"\n";
+            roofline_report<DTYPE>(queue, fused ? map_reduce_cost(NUM_DATA) : map_then_reduce_cost(NUM_DATA), time);
+            if (!fused) std::cout << "-- fused speedup : "<<time/fused_time<<"x\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            queue.memcpy(&result, device_result, sizeof(long long));
+            queue.wait();
+            validate(1, [&](size_t) { return reference.load(); }, &result);
+            #endif
+        }
+
+        pool_free(device_result, queue);
+    }
+
+
+    /********************************************************
+     *  Record and replay of a two-step pipeline : map into a scratch buffer, then copy out
+     *  - Iterations alternate between two (in, out) buffer pairs, so the replay updates its pointers
+     *  - Small problems, where the host submission cost is visible
+     ********************************************************/
+    std::cout << "\nRecorded pipeline replay vs re-submission ("<<NUM_REPLAYS<<" iterations)\n";
+    for (size_t count : {NUM_DATA>>14, NUM_DATA>>10}) {
+        RecordReplay replay(queue);
+        DTYPE* device_tmp = pool_malloc_device<DTYPE>(count, queue);
+
+        auto pipeline = [&](sycl::queue& q, int i) {
+            const DTYPE* pipe_in = device_in+(i%2)*count;
+            DTYPE* pipe_out = device_out+(i%2)*count;
+            map_range(q, pipe_in, device_tmp, count);
+            return q.memcpy(pipe_out, device_tmp, count*sizeof(DTYPE));
+        };
+
+        std::cout << "- "<<count<<" elements ("<<(replay.is_native() ? "sycl_ext_oneapi_graph" : "no graph support, re-submission")<<")\n";
+        measure_submission(replay.queue(), NUM_REPLAYS, [&](int i) {
+            pipeline(replay.queue(), i);
+        }).print("re-submission");
+        measure_submission(replay.queue(), NUM_REPLAYS, [&](int i) {
+            replay.run({device_in+(i%2)*count, device_tmp, device_out+(i%2)*count}, [&](sycl::queue& q) { return pipeline(q, i); });
+        }).print("replay");
+        std::cout << "-- recorded graphs : "<<replay.num_graphs()<<"\n";
+
+        #ifdef __MODE_DEBUG_TIME__
+        queue.memcpy(out.data(), device_out, 2*count*sizeof(DTYPE));
+        queue.wait();
+        validate(2*count, [&](size_t i) { return map(in[i]); }, out.data());
+        #endif
+
+        pool_free(device_tmp, queue);
+    }
+
+
+    /********************************************************
+     *  Multi-device partitioning : the range is split over all visible devices
+     ********************************************************/
+    std::cout << "\nMulti-device map (partitioned by range)\n";
+    {
+        MultiDeviceExecutor executor;
+        executor.calibrate();
+        executor.print_devices();
+
+        std::vector<DTYPE*> part_in(executor.num_devices()), part_out(executor.num_devices());
+        double base_time = 0;
+
+        for (size_t num_devices=1; num_devices<=executor.num_devices(); num_devices++) {
+
+            executor.use_devices(num_devices);
+            auto parts = executor.partition(NUM_DATA, 1024*WORK_PER_ITEM);
+
+            // Scatter
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                part_in[part.index] = pool_malloc_device<DTYPE>(part.size(), q);
+                part_out[part.index] = pool_malloc_device<DTYPE>(part.size(), q);
+                q.memcpy(part_in[part.index], in.data()+part.begin, part.size()*sizeof(DTYPE)).wait();
+                map_range(q, part_in[part.index], part_out[part.index], part.size()).wait();    // warming up
+            });
+
+            gettimeofday(&start, NULL);
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                for (int test=0; test<NUM_TESTS; test++)
+                    map_range(q, part_in[part.index], part_out[part.index], part.size()).wait();
+            });
+            gettimeofday(&end, NULL);
+
+            // Gather
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                q.memcpy(out.data()+part.begin, part_out[part.index], part.size()*sizeof(DTYPE)).wait();
+                pool_free(part_in[part.index], q);
+                pool_free(part_out[part.index], q);
+            });
+
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            if (num_devices == 1) base_time = time;
+            std::cout << "- "<<num_devices<<" device(s)\n";
+            std::cout << "-- Elasped time : "<<time<<" s (speedup "<<base_time/time<<"x)\n";
+            std::cout << "-- Effective bandwidth : "<<map_cost(NUM_DATA).bytes()/1024.0/1024.0/1024.0/time<<" GB/s\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            check_result(in, out);
+            std::memset(out.data(), 0, sizeof(DTYPE)*out.size());
+            #endif
+        }
+    }
+
+
+    /********************************************************
+     *  Out-of-core streaming : overlapped H2D, kernel and D2H
+     ********************************************************/
+    std::cout << "\nOut-of-core streaming map ("<<NUM_STREAM_CHUNKS<<" chunks, "<<NUM_STREAMS<<" streams)\n";
+    {
+        const size_t chunk_size = (NUM_DATA+NUM_STREAM_CHUNKS-1)/NUM_STREAM_CHUNKS;
+        StreamingEngine<DTYPE> engine(queue, chunk_size, chunk_size, NUM_STREAMS);
+
+        auto pack = [&](size_t chunk, DTYPE* staging_in) {
+            size_t offset = chunk*chunk_size;
+            size_t count = std::min(chunk_size, NUM_DATA-offset);
+            std::memcpy(staging_in, in.data()+offset, count*sizeof(DTYPE));
+            return StreamChunk{count, count};
+        };
+        auto launch = [&](sycl::queue& stream, size_t chunk, const DTYPE* d_in, DTYPE* d_out) {
+            size_t offset = chunk*chunk_size;
+            return map_range(stream, d_in, d_out, std::min(chunk_size, NUM_DATA-offset));
+        };
+        auto unpack = [&](size_t chunk, const DTYPE* staging_out, size_t count) {
+            std::memcpy(out.data()+chunk*chunk_size, staging_out, count*sizeof(DTYPE));
+        };
+
+        engine.run(NUM_STREAM_CHUNKS, pack, launch, unpack);    // warming up
+        StreamingStats stats = engine.run(NUM_STREAM_CHUNKS, pack, launch, unpack);
+        stats.print();
+    }
+
+    #ifdef __MODE_DEBUG_TIME__
+    check_result(in, out);
+    std::memset(out.data(), 0, sizeof(DTYPE)*out.size());
+    #endif
+
+
+    /********************************************************
+     *  File ingestion : input file -> map -> output file
+     *  - read then memcpy : fread the whole file into a host vector, one H2D copy, map, one D2H copy, fwrite
+     *  - memory-mapped : chunks go from the input mapping to the device and back into the output mapping,
+     *    directly where the mappings can be registered, through the pinned staging buffers otherwise
+     *  - A failed write, read or mapping is reported and skips the comparison
+     *  - The input was just written, so both read it from a warm page cache
+     ********************************************************/
+    std::cout << "\nFile ingestion : memory-mapped chunks vs read then memcpy ("<<NUM_STREAM_CHUNKS<<" chunks)\n";
+    {
+        const std::string in_path = data_file_path("sycl_primitives_map_in.npy");
+        const std::string out_path = data_file_path("sycl_primitives_map_out.npy");
+        bool ok = npy_fwrite(in_path, in.data(), {NUM_DATA});
+
+        gettimeofday(&start, NULL);
+        ok = ok && npy_fread(in_path, out.data(), NUM_DATA);
+        if (ok) {
+            queue.memcpy(device_in, out.data(), NUM_DATA*sizeof(DTYPE)).wait();
+            map_range(queue, device_in, device_out, NUM_DATA).wait();
+            queue.memcpy(out.data(), device_out, NUM_DATA*sizeof(DTYPE)).wait();
+        }
+        ok = ok && npy_fwrite(out_path, out.data(), {NUM_DATA});
+        gettimeofday(&end, NULL);
+        double baseline_time = ELAPSED_TIME(start, end);
+
+        bool direct = false;
+        gettimeofday(&start, NULL);
+        if (ok) {
+            MappedFile input = MappedFile::open<DTYPE>(in_path, NUM_DATA);
+            MappedFile output = MappedFile::create<DTYPE>(out_path, {NUM_DATA});
+            ok = input.is_open() && output.is_open();
+            direct = ok && input.register_for_device_copy(queue) && output.register_for_device_copy(queue);
+            const DTYPE* file_in = input.data<DTYPE>();
+            DTYPE* file_out = output.data<DTYPE>();
+
+            const size_t chunk_size = (NUM_DATA+NUM_STREAM_CHUNKS-1)/NUM_STREAM_CHUNKS;
+            StreamingEngine<DTYPE> engine(queue, chunk_size, chunk_size, NUM_STREAMS);
+
+            auto pack = [&](size_t chunk, DTYPE* staging_in) {
+                size_t offset = chunk*chunk_size;
+                size_t count = std::min(chunk_size, NUM_DATA-offset);
+                input.prefetch((offset+count)*sizeof(DTYPE), chunk_size*sizeof(DTYPE));
+                if (direct) return StreamChunk{count, count, file_in+offset, file_out+offset};
+                std::memcpy(staging_in, file_in+offset, count*sizeof(DTYPE));
+                return StreamChunk{count, count};
+            };
+            auto launch = [&](sycl::queue& stream, size_t chunk, const DTYPE* d_in, DTYPE* d_out) {
+                size_t offset = chunk*chunk_size;
+                return map_range(stream, d_in, d_out, std::min(chunk_size, NUM_DATA-offset));
+            };
+            auto unpack = [&](size_t chunk, const DTYPE* staging_out, size_t count) {
+                if (!direct) std::memcpy(file_out+chunk*chunk_size, staging_out, count*sizeof(DTYPE));
+            };
+            if (ok) engine.run(NUM_STREAM_CHUNKS, pack, launch, unpack);
+        }
+        gettimeofday(&end, NULL);
+        double mapped_time = ELAPSED_TIME(start, end);
+
+        if (!ok) std::cout << "--- [[[ERROR]]] File I/O failed, skipping the file ingestion comparison !!\n";
+        else {
+            double file_bytes = 2.0*sizeof(DTYPE)*NUM_DATA;
+            std::cout << "- read then memcpy : "<<baseline_time<<" s, "<<file_bytes/1024.0/1024.0/1024.0/baseline_time<<" GB/s file to file\n";
+            std::cout << "- memory-mapped ("<<(direct ? "registered, direct copies" : "staged through pinned buffers")<<") : "
+                      <<mapped_time<<" s, "<<file_bytes/1024.0/1024.0/1024.0/mapped_time<<" GB/s file to file (speedup "<<baseline_time/mapped_time<<"x)\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            MappedFile result = MappedFile::open<DTYPE>(out_path, NUM_DATA);
+            if (result.is_open()) validate(NUM_DATA, [&](size_t i) { return map(in[i]); }, result.data<DTYPE>());
+            #endif
+        }
+
+        std::remove(in_path.c_str());
+        std::remove(out_path.c_str());
+    }
+
+
+    /********************************************************
+     *  Per-call scratch allocation through the memory pool
+     ********************************************************/
+    std::cout << "\nUnrolled work intensive map with per-call output allocation (memory pool)\n";
+    gettimeofday(&start, NULL);
+    for (int test=0; test<NUM_TESTS; test++){
+        DTYPE* device_scratch = pool_malloc_device<DTYPE>(NUM_DATA, queue);
+        map_work_intensive_unrolled(queue, device_in, device_scratch);
+        pool_free(device_scratch, queue);
+    }
+    gettimeofday(&end, NULL);
+    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
+    MemoryPool::instance().print_stats();
+
+
 
     /********************************************************
      *  Finalize
      ********************************************************/
-    sycl::free (device_in, queue);
-    sycl::free (device_out, queue);
+    pool_free(device_in, queue);
+    pool_free(device_out, queue);
+    MemoryPool::instance().print_stats();
+    MemoryPool::instance().release();
     return 0;
 }
 
 void check_result(const std::vector<DTYPE>& in, const std::vector<DTYPE>& out) {
-    for (auto i=0; i!=in.size(); i++) {
-        if (map(in[i]) != out[i]) {
-            std::cout << "--- [[[ERROR]]] Checking the result failed at ["<<i<<"] "<<map(in[i])<<" != "<<out[i]<<" !!\n";
-            return ;
-        }
-    }
-
-    std::cout << "--- Checking the result succeed!!\n";
+    validate(in.size(), [&](size_t i) { return map(in[i]); }, out.data());
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../../common/layout.hpp"
+#include "matmul_local_memory.hpp"
+
+
+/********************************************************
+ *  Tiled matmul over matrices in a blocked or morton layout (common/layout.hpp), C = A*B
+ *  - Same local memory tiling as matmul_local_memory with gsize = the tile of the layouts : every A and B
+ *    tile loaded by a work-group is one contiguous block, and the zero padding removes the bound checks
+ *  - A [M,K], B [K,N] and C [M,N] must share the layout and the tile size
+ *  - Row-major layouts fall back to matmul_local_memory_async
+ ********************************************************/
+template <typename T>
+sycl::event matmul_blocked(sycl::queue& queue, const T* A, const T* B, T* C, const MatrixLayout a, const MatrixLayout b, const MatrixLayout c) {
+
+    if (a.layout == Layout::row_major)
+        return matmul_local_memory_async(queue, A, B, C, a.rows, b.cols, a.cols);
+
+    const size_t gsize = a.tile;
+    const size_t tiles_k = a.tiles_cols;
+
+    return queue.submit([&] (sycl::handler& cgh) {
+
+        sycl::accessor<T, 2, sycl::access::mode::read_write, sycl::access::target::local> local_A(sycl::range<2>(gsize, gsize+1), cgh);
+        sycl::accessor<T, 2, sycl::access::mode::read_write, sycl::access::target::local> local_B(sycl::range<2>(gsize, gsize), cgh);
+        cgh.parallel_for(sycl::nd_range<2>({c.tiles_rows*gsize, c.tiles_cols*gsize}, {gsize, gsize}), [=](sycl::nd_item<2> item) {
+
+            size_t tm = item.get_group(0);
+            size_t tn = item.get_group(1);
+            int lm = item.get_local_id(0);
+            int ln = item.get_local_id(1);
+            int local = lm*gsize+ln;
+
+            T sum = 0;
+            for (size_t tk=0; tk<tiles_k; tk++) {
+
+                local_A[lm][ln] = A[a.tile_offset(tm, tk)+local];
+                local_B[lm][ln] = B[b.tile_offset(tk, tn)+local];
+                item.barrier(sycl::access::fence_space::local_space);
+
+                for (size_t k=0; k<gsize; k++) {
+                    sum += local_A[lm][k]*local_B[k][ln];
+                }
+                item.barrier(sycl::access::fence_space::local_space);
+            }
+
+            C[c.tile_offset(tm, tn)+local] = sum;
+        });
+    });
+}
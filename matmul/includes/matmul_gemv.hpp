@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../../common/roofline.hpp"
+#include "../../common/reduction.hpp"
+
+
+/*** Roofline costs : A (or x and y) streamed once, the result written once ***/
+template <typename T>
+KernelCost dot_cost(const size_t n) {
+    return KernelCost{2.0*sizeof(T)*n, (double)sizeof(T), 2.0*n};
+}
+
+template <typename T>
+KernelCost gemv_cost(const size_t rows, const size_t cols) {
+    return KernelCost{(double)sizeof(T)*((double)rows*cols+cols), (double)sizeof(T)*rows, 2.0*rows*cols};
+}
+
+
+/********************************************************
+ *  Dot product : *result = sum of x[i]*y[i], fused product and reduction (common/reduction.hpp)
+ *  - Acc is the accumulator type (e.g. a wider integer)
+ ********************************************************/
+template <typename T, typename Acc>
+class DotFunc {
+
+    public:
+        DotFunc(const T* x, const T* y) : x(x), y(y) {}
+
+        Acc operator() (size_t i) const {
+            return (Acc)x[i]*(Acc)y[i];
+        }
+
+
+    private:
+        const T* x;
+        const T* y;
+};
+
+template <typename T, typename Acc=T>
+sycl::event dot(sycl::queue& queue, const T* x, const T* y, const size_t n, Acc* result) {
+    return transform_reduce(queue, n, DotFunc<T, Acc>(x, y), result);
+}
+
+
+/********************************************************
+ *  Matrix-vector product y = A*x, A [rows, cols] in row-major or column-major order
+ *  - Both versions stream A exactly once with coalesced reads, which is the bandwidth bound of GEMV
+ *  - row_major : a device-sized grid of work-groups walks over the rows (grid-stride), the work-items of a
+ *    group stride along the row and group_sum reduces it
+ *  - col_major : one work-item per row walks down a slice of the columns, neighbouring work-items read
+ *    neighbouring rows of a column; the columns are split into enough slices to fill the device,
+ *    and a second kernel sums the slices of every row
+ ********************************************************/
+enum class GemvOrder { row_major, col_major };
+
+template <typename T>
+sycl::event gemv(sycl::queue& queue, const T* A, const T* x, T* y, const size_t rows, const size_t cols, GemvOrder order, const size_t local_size=256) {
+
+    if (order == GemvOrder::row_major) {
+        size_t num_groups = persistent_groups(queue, local_size, rows);
+        return queue.submit([&] (sycl::handler& cgh) {
+            ReduceScratch<T> scratch(sycl::range<1>(local_size), cgh);
+            cgh.parallel_for(sycl::nd_range<1>(num_groups*local_size, local_size), [=](sycl::nd_item<1> item) {
+                persistent_for(item, rows, nullptr, [&](size_t row) {
+                    T sum = 0;
+                    for (size_t c=item.get_local_id(0); c<cols; c+=local_size)
+                        sum += A[row*cols+c]*x[c];
+                    sum = group_sum(item, sum, scratch);
+                    if (item.get_local_id(0) == 0)
+                        y[row] = sum;
+                });
+            });
+        });
+    }
+
+    // Column slices : about compute units x 2048 work-items in flight
+    const size_t target_items = persistent_groups(queue, local_size, (size_t)-1)*local_size;
+    const size_t slices = std::max((size_t)1, std::min(cols, target_items/std::max((size_t)1, rows)));
+    const size_t slice_cols = (cols+slices-1)/slices;
+    const size_t ceil_rows = ((rows+local_size-1)/local_size)*local_size;
+    T* partials = slices > 1 ? pool_malloc_device<T>(slices*rows, queue) : y;
+
+    sycl::event event = queue.submit([&] (sycl::handler& cgh) {
+        cgh.parallel_for(sycl::nd_range<2>({slices, ceil_rows}, {1, local_size}), [=](sycl::nd_item<2> item) {
+            size_t slice = item.get_global_id(0);
+            size_t row = item.get_global_id(1);
+            if (row >= rows) return;
+
+            T sum = 0;
+            size_t end = std::min(cols, (slice+1)*slice_cols);
+            for (size_t c=slice*slice_cols; c<end; c++)
+                sum += A[c*rows+row]*x[c];
+            partials[slice*rows+row] = sum;
+        });
+    });
+    if (slices == 1) return event;
+
+    event = queue.submit([&] (sycl::handler& cgh) {
+        cgh.depends_on(event);
+        cgh.parallel_for(sycl::range<1>(rows), [=](sycl::item<1> item) {
+            size_t row = item.get_linear_id();
+            T sum = 0;
+            for (size_t slice=0; slice<slices; slice++)
+                sum += partials[slice*rows+row];
+            y[row] = sum;
+        });
+    });
+    pool_free(partials, queue, event);
+    return event;
+}
@@ -1,13 +1,31 @@
 #pragma once
 
+#include "../../common/autotune.hpp"
+#include "../../common/roofline.hpp"
+
+
+/*** Roofline cost : A is read once per column of tiles, B once per row of tiles ***/
 template <typename T>
-void matmul_local_memory(sycl::queue queue, const T* A, const T* B, T*C, const size_t M, const size_t N, const size_t K, const size_t gsize=16) {
+KernelCost matmul_local_memory_cost(const size_t M, const size_t N, const size_t K, const size_t gsize=16) {
+    double tiles_m = (double)((M+gsize-1)/gsize);
+    double tiles_n = (double)((N+gsize-1)/gsize);
+    return KernelCost{sizeof(T)*((double)M*K*tiles_n+(double)K*N*tiles_m), (double)sizeof(T)*M*N, 2.0*M*N*K};
+}
+
+/*** lda/ldb/ldc : leading dimensions of sub-matrix views (0 = contiguous, K/N/N) ***/
+template <typename T>
+sycl::event matmul_local_memory_async(sycl::queue& queue, const T* A, const T* B, T*C, const size_t M, const size_t N, const size_t K, const size_t gsize=16,
+                                      size_t lda=0, size_t ldb=0, size_t ldc=0) {
+
+    if (lda == 0) lda = K;
+    if (ldb == 0) ldb = N;
+    if (ldc == 0) ldc = N;
 
     size_t ceil_M = ((M+gsize-1)/gsize)*gsize;
     size_t ceil_N = ((N+gsize-1)/gsize)*gsize;
     size_t ceil_K = ((K+gsize-1)/gsize)*gsize;
 
-    queue.submit([&] (sycl::handler& cgh) {
+    return queue.submit([&] (sycl::handler& cgh) {
 
         
         sycl::accessor<T, 2, sycl::access::mode::read_write, sycl::access::target::local> local_A(sycl::range<2>(gsize, gsize+1), cgh);
@@ -25,10 +43,10 @@ void matmul_local_memory(sycl::queue queue, const T* A, const T* B, T*C, const s
             for (int tile=0; tile<ceil_K; tile+=gsize) {
 
                 if (m<M && ln+tile<K)
-                    local_A[lm][ln] = A[m*K+(ln+tile)];
+                    local_A[lm][ln] = A[m*lda+(ln+tile)];
 
                 if (lm+tile<K && n<N)
-                    local_B[lm][ln] = B[(lm+tile)*N+n];
+                    local_B[lm][ln] = B[(lm+tile)*ldb+n];
                 item.barrier(sycl::access::fence_space::local_space);
 
 
@@ -39,11 +57,37 @@ void matmul_local_memory(sycl::queue queue, const T* A, const T* B, T*C, const s
             }
 
             if (m<M && n<N)
-                C[m*N+n] = sum;
+                C[m*ldc+n] = sum;
         });
 
     });
 
+}
+
+
+template <typename T>
+void matmul_local_memory(sycl::queue queue, const T* A, const T* B, T*C, const size_t M, const size_t N, const size_t K, const size_t gsize=16) {
+
+    matmul_local_memory_async(queue, A, B, C, M, N, K, gsize);
     queue.wait();
 
 }
+
+
+/*** Tuned configuration : {gsize} ***/
+template <typename T>
+void matmul_auto(sycl::queue& queue, const T* A, const T* B, T*C, const size_t M, const size_t N, const size_t K) {
+
+    size_t max_local = queue.get_device().get_info<sycl::info::device::max_work_group_size>();
+    size_t local_mem = queue.get_device().get_info<sycl::info::device::local_mem_size>();
+    auto space = tuning_space({{8, 16, 32}}, [&](const TuningConfig& c) {
+        return (size_t)(c[0]*c[0]) <= max_local && 2*c[0]*(c[0]+1)*sizeof(T) <= local_mem;
+    });
+
+    TuningConfig config = autotune(tuning_key<T>("matmul", queue, M*N*K), space, [&](const TuningConfig& c) {
+        matmul_local_memory_async(queue, A, B, C, M, N, K, c[0]).wait();
+    }, 1);
+
+    matmul_local_memory_async(queue, A, B, C, M, N, K, config[0]);
+    queue.wait();
+}
@@ -1,5 +1,15 @@
 #pragma once
 
+#include "../../common/roofline.hpp"
+
+
+/*** Roofline cost : without cache reuse every multiply-add loads one element of A and one of B ***/
+template <typename T>
+KernelCost matmul_naive_cost(const size_t M, const size_t N, const size_t K) {
+    return KernelCost{2.0*sizeof(T)*M*N*K, (double)sizeof(T)*M*N, 2.0*M*N*K};
+}
+
+
 template <typename T>
 void matmul_naive(sycl::queue queue, const T* A, const T* B, T*C, const size_t M, const size_t N, const size_t K, const size_t gsize=16) {
 
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../../common/persistent.hpp"
+#include "matmul_local_memory.hpp"
+
+
+/********************************************************
+ *  Persistent tiled matmul
+ *  - Same local memory tiling as matmul_local_memory, but a device-sized grid of gsize x gsize work-groups
+ *    loops over the C tiles (grid-stride or atomic work queue, see common/persistent.hpp)
+ *  - launch_per_element falls back to matmul_local_memory_async, one workitem per C element
+ ********************************************************/
+template <typename T>
+sycl::event matmul_persistent(sycl::queue& queue, const T* A, const T* B, T*C, const size_t M, const size_t N, const size_t K, Schedule schedule,
+                              const size_t gsize=16) {
+
+    if (schedule == Schedule::launch_per_element)
+        return matmul_local_memory_async(queue, A, B, C, M, N, K, gsize);
+
+    const size_t tiles_n = (N+gsize-1)/gsize;
+    const size_t num_tiles = ((M+gsize-1)/gsize)*tiles_n;
+    const size_t ceil_K = ((K+gsize-1)/gsize)*gsize;
+
+    return persistent_launch(queue, schedule, gsize*gsize, num_tiles, [&](sycl::handler& cgh, size_t num_groups, unsigned int* counter) {
+
+        sycl::accessor<T, 2, sycl::access::mode::read_write, sycl::access::target::local> local_A(sycl::range<2>(gsize, gsize+1), cgh);
+        sycl::accessor<T, 2, sycl::access::mode::read_write, sycl::access::target::local> local_B(sycl::range<2>(gsize, gsize), cgh);
+        cgh.parallel_for(sycl::nd_range<1>(num_groups*gsize*gsize, gsize*gsize), [=](sycl::nd_item<1> item) {
+
+            int lm = item.get_local_id(0)/gsize;
+            int ln = item.get_local_id(0)%gsize;
+
+            persistent_for(item, num_tiles, counter, [&](size_t tile) {
+
+                size_t m = (tile/tiles_n)*gsize+lm;
+                size_t n = (tile%tiles_n)*gsize+ln;
+
+                T sum = 0;
+                for (size_t k_tile=0; k_tile<ceil_K; k_tile+=gsize) {
+
+                    if (m<M && ln+k_tile<K)
+                        local_A[lm][ln] = A[m*K+(ln+k_tile)];
+
+                    if (lm+k_tile<K && n<N)
+                        local_B[lm][ln] = B[(lm+k_tile)*N+n];
+                    item.barrier(sycl::access::fence_space::local_space);
+
+                    for (size_t k=0; k<gsize && k+k_tile<K; k++) {
+                        sum += local_A[lm][k]*local_B[k][ln];
+                    }
+
+                    // Also protects local_A/local_B before the next tile
+                    item.barrier(sycl::access::fence_space::local_space);
+                }
+
+                if (m<M && n<N)
+                    C[m*N+n] = sum;
+            });
+        });
+    });
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include "matmul_local_memory.hpp"
+
+
+/*** D = a*X + b*Y over [rows,cols] sub-matrix views with leading dimensions (D = a*X if Y is nullptr) ***/
+template <typename T>
+sycl::event matmul_strassen_axpby(sycl::queue& queue, T* D, const size_t ldd, const T a, const T* X, const size_t ldx, const T b, const T* Y, const size_t ldy,
+                                  const size_t rows, const size_t cols) {
+
+    const size_t gsize = 16;
+    size_t ceil_rows = ((rows+gsize-1)/gsize)*gsize;
+    size_t ceil_cols = ((cols+gsize-1)/gsize)*gsize;
+
+    return queue.submit([&] (sycl::handler& cgh) {
+        cgh.parallel_for(sycl::nd_range<2>({ceil_rows, ceil_cols}, {gsize, gsize}), [=](sycl::nd_item<2> item) {
+
+            size_t y = item.get_global_id(0);
+            size_t x = item.get_global_id(1);
+
+            if (y<rows && x<cols)
+                D[y*ldd+x] = Y == nullptr ? a*X[y*ldx+x] : a*X[y*ldx+x] + b*Y[y*ldy+x];
+        });
+    });
+}
+
+
+/********************************************************
+ *  Strassen recursive matmul C[M,N] = A[M,K] * B[K,N]
+ *  - A level splits every matrix into 2x2 quadrants and computes 7 half-size products instead of 8
+ *  - Levels are applied while M, N and K are even and at least crossover (and at most max_levels times)
+ *  - Operand sums and C updates run as element-wise device kernels, the leaves call the tiled kernel
+ *  - The operand and product workspace of every level is allocated once in the constructor, from the memory
+ *    pool through the caller's queue (a pool free list per private queue would outlive the instance),
+ *    all the work is submitted to an in-order queue so that a level reuses its buffers for the 7 products
+ ********************************************************/
+template <typename T>
+class MatmulStrassen {
+
+    public:
+        MatmulStrassen(sycl::queue& queue, size_t M, size_t N, size_t K, size_t crossover, int max_levels=8, size_t gsize=16)
+            : owner(queue), stream(queue.get_context(), queue.get_device(), sycl::property_list{sycl::property::queue::in_order()}),
+              M(M), N(N), K(K), gsize(gsize) {
+
+            size_t m = M, n = N, k = K, total = 0;
+            while ((int)levels.size() < max_levels && m%2 == 0 && n%2 == 0 && k%2 == 0 && std::min({m, n, k}) >= crossover) {
+                m /= 2; n /= 2; k /= 2;
+                levels.push_back(Level{m, n, k, total, nullptr, nullptr, nullptr});
+                total += m*k + k*n + m*n;
+            }
+
+            // A block reused in stream order on the caller's queue may still be read there : let it finish
+            workspace = total > 0 ? pool_malloc_device<T>(total, owner) : nullptr;
+            owner.wait();
+            for (auto& level : levels) {
+                level.SA = workspace+level.offset;
+                level.SB = level.SA+level.m*level.k;
+                level.P = level.SB+level.k*level.n;
+            }
+            workspace_elems = total;
+        }
+
+        ~MatmulStrassen() {
+            stream.wait();
+            if (workspace != nullptr) pool_free(workspace, owner);
+        }
+
+        MatmulStrassen(const MatmulStrassen&) = delete;
+        MatmulStrassen& operator=(const MatmulStrassen&) = delete;
+
+        int num_levels() const { return (int)levels.size(); }
+        size_t workspace_bytes() const { return workspace_elems*sizeof(T); }
+
+        // A, B, C must be ready when run() is called, wait on the returned event
+        sycl::event run(const T* A, const T* B, T* C) {
+            multiply(0, A, K, B, N, C, N, M, N, K);
+            return last;
+        }
+
+
+    private:
+        struct Level {
+            size_t m, n, k;     // quadrant sizes
+            size_t offset;
+            T* SA;              // [m,k] A operand
+            T* SB;              // [k,n] B operand
+            T* P;               // [m,n] product
+        };
+
+        // Operand X+sign*Y, formed in work (a single quadrant, Y == nullptr, is used in place)
+        void operand(const T* X, T sign, const T* Y, size_t ld, T* work, size_t rows, size_t cols, const T*& op, size_t& ld_op) {
+            if (Y == nullptr) {
+                op = X;
+                ld_op = ld;
+                return;
+            }
+            last = matmul_strassen_axpby(stream, work, cols, (T)1, X, ld, sign, Y, ld, rows, cols);
+            op = work;
+            ld_op = cols;
+        }
+
+        // C = sign*P on the first contribution to a quadrant, C += sign*P afterwards
+        void update(T* C, size_t ldc, T sign, bool first, const T* P, size_t rows, size_t cols) {
+            if (first) last = matmul_strassen_axpby(stream, C, ldc, sign, P, cols, (T)0, (const T*)nullptr, 0, rows, cols);
+            else last = matmul_strassen_axpby(stream, C, ldc, (T)1, (const T*)C, ldc, sign, P, cols, rows, cols);
+        }
+
+        void multiply(size_t l, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc, size_t m, size_t n, size_t k) {
+
+            if (l == levels.size()) {
+                last = matmul_local_memory_async(stream, A, B, C, m, n, k, gsize, lda, ldb, ldc);
+                return;
+            }
+
+            Level& w = levels[l];
+            const T* A11 = A;             const T* A12 = A+w.k;
+            const T* A21 = A+w.m*lda;     const T* A22 = A21+w.k;
+            const T* B11 = B;             const T* B12 = B+w.n;
+            const T* B21 = B+w.k*ldb;     const T* B22 = B21+w.n;
+            T* C11 = C;                   T* C12 = C+w.n;
+            T* C21 = C+w.m*ldc;           T* C22 = C21+w.n;
+
+            // One product P = (XA + sa*YA) * (XB + sb*YB), then its contributions to C
+            auto product = [&](const T* XA, T sa, const T* YA, const T* XB, T sb, const T* YB) {
+                const T* opA; const T* opB;
+                size_t ld_opA, ld_opB;
+                operand(XA, sa, YA, lda, w.SA, w.m, w.k, opA, ld_opA);
+                operand(XB, sb, YB, ldb, w.SB, w.k, w.n, opB, ld_opB);
+                multiply(l+1, opA, ld_opA, opB, ld_opB, w.P, w.n, w.m, w.n, w.k);
+            };
+
+            // M1 = (A11+A22)(B11+B22) : C11 = M1, C22 = M1
+            product(A11, 1, A22, B11, 1, B22);
+            update(C11, ldc, 1, true, w.P, w.m, w.n);
+            update(C22, ldc, 1, true, w.P, w.m, w.n);
+
+            // M2 = (A21+A22)B11 : C21 = M2, C22 -= M2
+            product(A21, 1, A22, B11, 0, nullptr);
+            update(C21, ldc, 1, true, w.P, w.m, w.n);
+            update(C22, ldc, -1, false, w.P, w.m, w.n);
+
+            // M3 = A11(B12-B22) : C12 = M3, C22 += M3
+            product(A11, 0, nullptr, B12, -1, B22);
+            update(C12, ldc, 1, true, w.P, w.m, w.n);
+            update(C22, ldc, 1, false, w.P, w.m, w.n);
+
+            // M4 = A22(B21-B11) : C11 += M4, C21 += M4
+            product(A22, 0, nullptr, B21, -1, B11);
+            update(C11, ldc, 1, false, w.P, w.m, w.n);
+            update(C21, ldc, 1, false, w.P, w.m, w.n);
+
+            // M5 = (A11+A12)B22 : C11 -= M5, C12 += M5
+            product(A11, 1, A12, B22, 0, nullptr);
+            update(C11, ldc, -1, false, w.P, w.m, w.n);
+            update(C12, ldc, 1, false, w.P, w.m, w.n);
+
+            // M6 = (A21-A11)(B11+B12) : C22 += M6
+            product(A21, -1, A11, B11, 1, B12);
+            update(C22, ldc, 1, false, w.P, w.m, w.n);
+
+            // M7 = (A12-A22)(B21+B22) : C11 += M7
+            product(A12, -1, A22, B21, 1, B22);
+            update(C11, ldc, 1, false, w.P, w.m, w.n);
+        }
+
+        sycl::queue owner;     // caller's queue, the workspace is allocated and freed through it
+        sycl::queue stream;
+        size_t M, N, K;
+        size_t gsize;
+        std::vector<Level> levels;
+        T* workspace = nullptr;
+        size_t workspace_elems = 0;
+        sycl::event last;
+};
@@ -1,8 +1,13 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstring>
 #include <CL/sycl.hpp>
 namespace sycl=cl::sycl;
+#include "../common/memory_pool.hpp"
+#include "../common/device_select.hpp"
+#include "../common/roofline.hpp"
+#include "../common/validation.hpp"
 
 /*** Measure performance ***/
 #include <sys/time.h>
@@ -11,23 +16,45 @@ timeval start, end;
 
 /*** Data configuration ***/
 #define DTYPE long
+#ifdef __MODE_SMALL_PROBLEM__
+const int M=1024*2, N=1024*2, K=1024*2;
+#else
 const int M=1024*15, N=1024*15, K=1024*15;
+#endif
+
+/*** Streaming configuration ***/
+const size_t STREAM_TILE=M/8;
+const size_t NUM_STREAMS=3;
+
+/*** Record and replay configuration ***/
+const int NUM_REPLAYS=200;
+
+/*** Blocked layout pipeline configuration ***/
+const int NUM_PIPELINE=3;    // steps X <- transpose(X*B)
 
 /*** Debugging info ***/
-//#define __MODE_DEBUG_TIME__
+#define __MODE_DEBUG_TIME__
 const int NUM_TESTS=2;
 void check_result(const std::vector<DTYPE>&,const std::vector<DTYPE>&,const std::vector<DTYPE>&);
 
 /*** Parallel algorithm implementations ***/
 #include "includes/matmul_naive.hpp"
 #include "includes/matmul_local_memory.hpp"
+#include "includes/matmul_strassen.hpp"
+#include "includes/matmul_persistent.hpp"
+#include "includes/matmul_blocked.hpp"
+#include "includes/matmul_gemv.hpp"
+#include "../transpose/includes/transpose_blocked.hpp"
+#include "../common/streaming.hpp"
+#include "../common/multi_device.hpp"
+#include "../common/graph.hpp"
 
 
-int main(void) {
+int main(int argc, char* argv[]) {
 
     std::cout << "=================================================\n";
     std::cout << "SYCL Primitives : Parallel 2D Matrix Multiplication\n";
-    std::cout << "-- a single nvidia GPU example\n";
+    std::cout << "-- a single device example (--device=<gpu|cpu|acc|index|name>)\n";
     std::cout << "-- 2D Matrix : A["<<M<<","<<K<<"] * B["<<K<<","<<N<<"] = C["<<M<<","<<N<<"]\n";
     std::cout << "-- total size of three 2D matrices: "<<sizeof(DTYPE)*(M*N+M*K+K*N)/1024.0/1024.0/1024.0<<" GB\n";
     std::cout << "=================================================\n\n";
@@ -35,8 +62,9 @@ int main(void) {
     /********************************************************
      *  SYCL setup
      ********************************************************/
-    sycl::gpu_selector device;
-    sycl::queue queue(device);
+    sycl::queue queue(select_device(argc, argv));
+    std::cout << "Running on "<<queue.get_device().get_info<sycl::info::device::name>()<<"\n";
+    measure_roof<DTYPE>(queue);    // one-time bandwidth and compute roof of the device
 
     /********************************************************
      *  Data initilzation
@@ -44,18 +72,18 @@ int main(void) {
     // Input data A
     std::vector<DTYPE> A(M*K);
     std::generate(A.begin(), A.end(), [](){return (std::rand()%100-50);});
-    DTYPE* device_A = sycl::malloc_device<DTYPE>(M*K, queue);
+    DTYPE* device_A = pool_malloc_device<DTYPE>(M*K, queue);
     queue.memcpy(device_A, A.data(), M*K*sizeof(DTYPE));
 
     // Input data B
     std::vector<DTYPE> B(K*N);
     std::generate(B.begin(), B.end(), [](){return (std::rand()%100-50);});
-    DTYPE* device_B = sycl::malloc_device<DTYPE>(K*N, queue);
+    DTYPE* device_B = pool_malloc_device<DTYPE>(K*N, queue);
     queue.memcpy(device_B, B.data(), K*N*sizeof(DTYPE));
     
     // Output data C
     std::vector<DTYPE> C(M*N);
-    DTYPE* device_C = sycl::malloc_device<DTYPE>(M*N, queue);
+    DTYPE* device_C = pool_malloc_device<DTYPE>(M*N, queue);
 
     // For initial warming up
     matmul_naive(queue, device_A, device_B, device_C, M, N, K);
@@ -73,9 +101,7 @@ int main(void) {
         matmul_naive(queue, device_A, device_B, device_C, M, N, K);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*M/1024.0*N/1024.0*K/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
-    std::cout << "-- Multiplications per second : "<<M/1024.0*N/1024.0*K/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" Gops\n";
+    roofline_report<DTYPE>(queue, matmul_naive_cost<DTYPE>(M, N, K), ELAPSED_TIME(start, end)/NUM_TESTS);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(C.data(), device_C, M*N*sizeof(DTYPE));
@@ -93,9 +119,8 @@ int main(void) {
         matmul_local_memory(queue, device_A, device_B, device_C, M, N, K);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*M/1024.0*N/1024.0*K/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
-    std::cout << "-- Multiplications per second : "<<M/1024.0*N/1024.0*K/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" Gops\n";
+    double local_memory_time = ELAPSED_TIME(start, end)/NUM_TESTS;
+    roofline_report<DTYPE>(queue, matmul_local_memory_cost<DTYPE>(M, N, K), local_memory_time);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(C.data(), device_C, M*N*sizeof(DTYPE));
@@ -104,12 +129,435 @@ int main(void) {
     #endif
 
 
+   /********************************************************
+     *  Auto-tuned implementation : {gsize}
+     ********************************************************/
+    std::cout << "\nAuto-tuned parallel matmul with local memory (tuning cache : "<<TuningCache::instance().file()<<")\n";
+    matmul_auto(queue, device_A, device_B, device_C, M, N, K);    // tunes on the first call, then reads the cache
+    gettimeofday(&start, NULL);
+    for (int test=0; test<NUM_TESTS; test++){
+        matmul_auto(queue, device_A, device_B, device_C, M, N, K);
+    }
+    gettimeofday(&end, NULL);
+    roofline_report<DTYPE>(queue, matmul_local_memory_cost<DTYPE>(M, N, K), ELAPSED_TIME(start, end)/NUM_TESTS);    // tuned gsize may differ from 16
+
+    #ifdef __MODE_DEBUG_TIME__
+    queue.memcpy(C.data(), device_C, M*N*sizeof(DTYPE));
+    queue.wait();
+    check_result(A, B, C);
+    #endif
+
+
+   /********************************************************
+     *  Strassen recursive matmul
+     *  - Crossover : smallest n where one Strassen level beats the tiled kernel on n x n matrices
+     *  - The full-size run applies levels while the matrices are at least the crossover size
+     ********************************************************/
+    std::cout << "\nStrassen recursive matmul over the tiled kernel\n";
+    {
+        const size_t max_sweep = std::min({M, N, K});
+        size_t crossover = 0;
+        for (size_t n=512; n<=max_sweep; n*=2) {
+
+            // The leading n*n elements of the resident buffers serve as n x n matrices
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++)
+                matmul_local_memory(queue, device_A, device_B, device_C, n, n, n);
+            gettimeofday(&end, NULL);
+            double tiled_time = ELAPSED_TIME(start, end)/NUM_TESTS;
+
+            MatmulStrassen<DTYPE> strassen(queue, n, n, n, 0, 1);
+            strassen.run(device_A, device_B, device_C).wait();    // warming up
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++)
+                strassen.run(device_A, device_B, device_C).wait();
+            gettimeofday(&end, NULL);
+            double strassen_time = ELAPSED_TIME(start, end)/NUM_TESTS;
+
+            std::cout << "-- n="<<n<<" : tiled "<<tiled_time<<" s, 1 Strassen level "<<strassen_time<<" s (speedup "<<tiled_time/strassen_time<<"x)\n";
+            if (crossover == 0 && strassen_time < tiled_time) crossover = n;
+        }
+
+        if (crossover == 0) {
+            crossover = 2*max_sweep;
+            std::cout << "-- Crossover size : none up to "<<max_sweep<<", no Strassen level is applied\n";
+        } else {
+            std::cout << "-- Crossover size : "<<crossover<<"\n";
+        }
+
+        MatmulStrassen<DTYPE> strassen(queue, M, N, K, crossover);
+        std::cout << "- "<<strassen.num_levels()<<" Strassen level(s), workspace "<<strassen.workspace_bytes()/1024.0/1024.0<<" MB\n";
+        strassen.run(device_A, device_B, device_C).wait();    // warming up
+        gettimeofday(&start, NULL);
+        for (int test=0; test<NUM_TESTS; test++)
+            strassen.run(device_A, device_B, device_C).wait();
+        gettimeofday(&end, NULL);
+        double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+        std::cout << "-- Elasped time : "<<time<<" s (speedup "<<local_memory_time/time<<"x over the tiled kernel)\n";
+        std::cout << "-- Effective operations per second (2MNK/time) : "<<2.0*M*N*K/1024.0/1024.0/1024.0/time<<" Gops\n";
+    }
+
+    #ifdef __MODE_DEBUG_TIME__
+    queue.memcpy(C.data(), device_C, M*N*sizeof(DTYPE));
+    queue.wait();
+    check_result(A, B, C);
+    #endif
+
+
+   /********************************************************
+     *  Persistent tiled matmul vs launch per element across problem sizes
+     *  - The leading n*n elements of the resident buffers serve as n x n matrices
+     ********************************************************/
+    std::cout << "\nPersistent tiled matmul (device-sized grid) vs launch per element\n";
+    for (size_t n : {(size_t)M/4, (size_t)M/2, (size_t)M}) {
+        if (n == (size_t)M && (M != N || M != K)) continue;
+        std::cout << "- "<<n<<"x"<<n<<" matrices\n";
+        for (Schedule schedule : {Schedule::launch_per_element, Schedule::grid_stride, Schedule::work_queue}) {
+            matmul_persistent(queue, device_A, device_B, device_C, n, n, n, schedule).wait();    // warming up
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++){
+                matmul_persistent(queue, device_A, device_B, device_C, n, n, n, schedule).wait();
+            }
+            gettimeofday(&end, NULL);
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            std::cout << "-- "<<schedule_name(schedule)<<" : "<<time<<" s, "<<2.0*n*n*n/1024.0/1024.0/1024.0/time<<" Gops\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            if (n == (size_t)M) {
+                queue.memcpy(C.data(), device_C, M*N*sizeof(DTYPE));
+                queue.wait();
+                check_result(A, B, C);
+            }
+            #endif
+        }
+    }
+
+
+   /********************************************************
+     *  Blocked layouts : pipeline of NUM_PIPELINE steps X <- transpose(X*B) on n x n matrices, X = A at first
+     *  - row-major : matmul_local_memory and transpose_coalesced
+     *  - blocked / morton : A is converted in and the result out, every step stays on the tiles
+     *    (B is converted once outside the timing, as a reused operand would be)
+     ********************************************************/
+    std::cout << "\nMatmul + transpose pipeline in blocked layouts ("<<NUM_PIPELINE<<" steps)\n";
+    if (M == N && M == K) {
+        const size_t n = M/4;
+        const size_t gsize = 16;
+        std::cout << "- "<<n<<"x"<<n<<" matrices (the leading n*n elements of A and B)\n";
+        std::vector<DTYPE> reference(n*n);
+        double row_major_time = 0;
+        for (Layout layout : {Layout::row_major, Layout::blocked, Layout::morton}) {
+
+            MatrixLayout shape(layout, n, n, gsize);
+            DTYPE* device_X = pool_malloc_device<DTYPE>(shape.size(), queue);
+            DTYPE* device_Y = pool_malloc_device<DTYPE>(shape.size(), queue);
+            DTYPE* device_LB = pool_malloc_device<DTYPE>(shape.size(), queue);
+            to_layout<DTYPE>(queue, device_B, device_LB, shape).wait();
+
+            auto pipeline = [&]() {
+                to_layout<DTYPE>(queue, device_A, device_X, shape).wait();
+                for (int step=0; step<NUM_PIPELINE; step++) {
+                    matmul_blocked<DTYPE>(queue, device_X, device_LB, device_Y, shape, shape, shape).wait();
+                    transpose_blocked<DTYPE>(queue, device_Y, device_X, shape).wait();
+                }
+                from_layout<DTYPE>(queue, device_X, device_C, shape).wait();
+            };
+
+            pipeline();    // warming up
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++){
+                pipeline();
+            }
+            gettimeofday(&end, NULL);
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            if (layout == Layout::row_major) row_major_time = time;
+            std::cout << "-- "<<layout_name(layout)<<" : "<<time<<" s, "<<NUM_PIPELINE*2.0*n*n*n/1024.0/1024.0/1024.0/time
+                      <<" Gops (speedup "<<row_major_time/time<<"x)\n";
+
+            // The row-major pipeline is the reference of the blocked ones
+            #ifdef __MODE_DEBUG_TIME__
+            queue.memcpy(C.data(), device_C, n*n*sizeof(DTYPE));
+            queue.wait();
+            if (layout == Layout::row_major) std::copy(C.begin(), C.begin()+n*n, reference.begin());
+            else validate(n*n, [&](size_t i) { return reference[i]; }, C.data(), n);
+            #endif
+
+            pool_free(device_X, queue);
+            pool_free(device_Y, queue);
+            pool_free(device_LB, queue);
+        }
+    }
+
+
+   /********************************************************
+     *  Fused dot product vs elementwise product then sum, and GEMV in both orders of A
+     *  - dot(A, B) over their leading count elements, GEMV y = A*x with A [M,K] (x : leading K of B, y : leading M of C)
+     ********************************************************/
+    std::cout << "\nFused dot product vs product then sum\n";
+    {
+        const size_t count = std::min({(size_t)M*K, (size_t)K*N, (size_t)M*N});
+        DTYPE* device_result = pool_malloc_device<DTYPE>(1, queue);
+        DTYPE result = 0;
+
+        double fused_time = 0;
+        for (bool fused : {true, false}) {
+            auto run = [&]() {
+                if (fused) return dot(queue, device_A, device_B, count, device_result);
+                const DTYPE* a = device_A;
+                const DTYPE* b = device_B;
+                DTYPE* c = device_C;
+                sycl::event product = queue.submit([&] (sycl::handler& cgh) {
+                    cgh.parallel_for(sycl::range<1>(count), [=](sycl::item<1> item) {
+                        size_t i = item.get_linear_id();
+                        c[i] = a[i]*b[i];
+                    });
+                });
+                return transform_reduce(queue, count, ReduceLoad<DTYPE>{device_C}, device_result, product);
+            };
+            run().wait();    // warming up
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++){
+                run().wait();
+            }
+            gettimeofday(&end, NULL);
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            if (fused) fused_time = time;
+            KernelCost cost = dot_cost<DTYPE>(count);
+            if (!fused) cost = KernelCost{3.0*sizeof(DTYPE)*count, (double)sizeof(DTYPE)*count, 2.0*count};
+            std::cout << "- "<<(fused ? "fused dot" : "product then sum")<<" ("<<count<<" elements)\n";
+            roofline_report<DTYPE>(queue, cost, time);
+            if (!fused) std::cout << "-- fused speedup : "<<time/fused_time<<"x\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            queue.memcpy(&result, device_result, sizeof(DTYPE));
+            queue.wait();
+            std::atomic<DTYPE> reference(0);
+            parallel_for_blocks(count, [&](size_t begin, size_t end) {
+                DTYPE sum = 0;
+                for (size_t i=begin; i<end; i++) sum += A[i]*B[i];
+                reference += sum;
+            });
+            validate(1, [&](size_t) { return reference.load(); }, &result);
+            #endif
+        }
+        pool_free(device_result, queue);
+
+        std::cout << "\nGEMV y = A*x, A ["<<M<<","<<K<<"]\n";
+        for (GemvOrder order : {GemvOrder::row_major, GemvOrder::col_major}) {
+            gemv(queue, device_A, device_B, device_C, M, K, order).wait();    // warming up
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++){
+                gemv(queue, device_A, device_B, device_C, M, K, order).wait();
+            }
+            gettimeofday(&end, NULL);
+            std::cout << "- "<<(order == GemvOrder::row_major ? "row-major A" : "column-major A")<<"\n";
+            roofline_report<DTYPE>(queue, gemv_cost<DTYPE>(M, K), ELAPSED_TIME(start, end)/NUM_TESTS);
+
+            // The same data read as [M,K] row-major or column-major
+            #ifdef __MODE_DEBUG_TIME__
+            queue.memcpy(C.data(), device_C, M*sizeof(DTYPE));
+            queue.wait();
+            validate(M, [&](size_t m) {
+                DTYPE sum = 0;
+                for (size_t k=0; k<(size_t)K; k++)
+                    sum += (order == GemvOrder::row_major ? A[m*K+k] : A[k*M+m])*B[k];
+                return sum;
+            }, C.data());
+            #endif
+        }
+    }
+
+
+   /********************************************************
+     *  Record and replay of small matmuls, where the host submission cost is visible
+     *  - Iterations alternate between two C buffers, so the replay updates its pointers
+     ********************************************************/
+    std::cout << "\nRecorded matmul replay vs re-submission ("<<NUM_REPLAYS<<" iterations)\n";
+    for (size_t n : {(size_t)256, (size_t)1024}) {
+        RecordReplay replay(queue);
+
+        auto pipeline = [&](sycl::queue& q, int i) {
+            return matmul_local_memory_async(q, device_A, device_B, device_C+(i%2)*n*n, n, n, n);
+        };
+
+        std::cout << "- "<<n<<"x"<<n<<" matrices ("<<(replay.is_native() ? "sycl_ext_oneapi_graph" : "no graph support, re-submission")<<")\n";
+        measure_submission(replay.queue(), NUM_REPLAYS, [&](int i) {
+            pipeline(replay.queue(), i);
+        }).print("re-submission");
+        measure_submission(replay.queue(), NUM_REPLAYS, [&](int i) {
+            replay.run({device_A, device_B, device_C+(i%2)*n*n}, [&](sycl::queue& q) { return pipeline(q, i); });
+        }).print("replay");
+        std::cout << "-- recorded graphs : "<<replay.num_graphs()<<"\n";
+
+        // The leading n*n elements of A and B are the n x n operands, small enough for a full O(n^3) reference
+        #ifdef __MODE_DEBUG_TIME__
+        queue.memcpy(C.data(), device_C, 2*n*n*sizeof(DTYPE));
+        queue.wait();
+        std::vector<DTYPE> reference(n*n);
+        matmul_reference(A.data(), B.data(), reference.data(), n, n, n);
+        validate(2*n*n, [&](size_t i) { return reference[i%(n*n)]; }, C.data(), n);
+        #endif
+    }
+
+
+    // The resident matrices are not needed anymore, their blocks go back to the pool
+    pool_free(device_A, queue);
+    pool_free(device_B, queue);
+    pool_free(device_C, queue);
+
+
+    /********************************************************
+     *  Out-of-core tiled streaming
+     *  - B is swept by column panels as wide as a quarter of the device memory allows (a multiple of
+     *    STREAM_TILE, the whole B when it fits), each panel is uploaded once and stays resident
+     *  - For every panel, the A row panels [STREAM_TILE,K] stream through the engine and the C tiles
+     *    [STREAM_TILE,panel] come back, so A crosses the bus once per B panel and B only once
+     *  - The B panel is one strided host to device copy with sycl_ext_oneapi_memcpy2d, packed into pinned
+     *    memory then copied otherwise
+     ********************************************************/
+    std::cout << "\nOut-of-core tiled matmul (row panels of "<<STREAM_TILE<<", "<<NUM_STREAMS<<" streams)\n";
+    {
+        size_t device_budget = std::min<size_t>(queue.get_device().get_info<sycl::info::device::global_mem_size>()/4,
+                                                queue.get_device().get_info<sycl::info::device::max_mem_alloc_size>());
+        const size_t panel_n = std::min((size_t)N, std::max(STREAM_TILE, device_budget/(sizeof(DTYPE)*K)/STREAM_TILE*STREAM_TILE));
+        const size_t tiles_m = (M+STREAM_TILE-1)/STREAM_TILE;
+        const size_t panels_n = (N+panel_n-1)/panel_n;
+        std::cout << "- resident B panel : "<<K<<"x"<<panel_n<<" ("<<panels_n<<" panels)\n";
+
+        StreamingEngine<DTYPE> engine(queue, STREAM_TILE*K, STREAM_TILE*panel_n, NUM_STREAMS);
+        DTYPE* device_panel = pool_malloc_device<DTYPE>(K*panel_n, queue);
+        #ifndef SYCL_EXT_ONEAPI_MEMCPY2D
+        DTYPE* host_panel = pool_malloc_host<DTYPE>(K*panel_n, queue);
+        #endif
+
+        StreamingStats stats;
+        gettimeofday(&start, NULL);
+        for (size_t panel=0; panel<panels_n; panel++) {
+            const size_t n0 = panel*panel_n;
+            const size_t nb = std::min(panel_n, N-n0);
+
+            // B[:, n0:n0+nb] -> [K,nb] resident panel
+            #ifdef SYCL_EXT_ONEAPI_MEMCPY2D
+            queue.ext_oneapi_copy2d(B.data()+n0, (size_t)N, device_panel, nb, nb, (size_t)K).wait();
+            #else
+            for (size_t k=0; k<K; k++)
+                std::memcpy(host_panel+k*nb, B.data()+k*N+n0, sizeof(DTYPE)*nb);
+            queue.memcpy(device_panel, host_panel, sizeof(DTYPE)*K*nb).wait();
+            #endif
+            stats.bytes_in += sizeof(DTYPE)*K*nb;
+
+            auto pack = [&](size_t chunk, DTYPE* staging_in) {
+                size_t m0 = chunk*STREAM_TILE, mb = std::min(STREAM_TILE, M-m0);
+                std::memcpy(staging_in, A.data()+m0*K, sizeof(DTYPE)*mb*K);
+                return StreamChunk{mb*K, mb*nb};
+            };
+            auto launch = [&](sycl::queue& stream, size_t chunk, const DTYPE* d_in, DTYPE* d_out) {
+                size_t mb = std::min(STREAM_TILE, M-chunk*STREAM_TILE);
+                return matmul_local_memory_async(stream, d_in, device_panel, d_out, mb, nb, K);
+            };
+            auto unpack = [&](size_t chunk, const DTYPE* staging_out, size_t count) {
+                size_t m0 = chunk*STREAM_TILE, mb = std::min(STREAM_TILE, M-m0);
+                for (size_t m=0; m<mb; m++)
+                    std::memcpy(C.data()+(m0+m)*N+n0, staging_out+m*nb, sizeof(DTYPE)*nb);
+            };
+
+            StreamingStats panel_stats = engine.run(tiles_m, pack, launch, unpack);
+            stats.h2d += panel_stats.h2d;
+            stats.kernel += panel_stats.kernel;
+            stats.d2h += panel_stats.d2h;
+            stats.host += panel_stats.host;
+            stats.bytes_in += panel_stats.bytes_in;
+            stats.bytes_out += panel_stats.bytes_out;
+        }
+        gettimeofday(&end, NULL);
+        stats.wall = ELAPSED_TIME(start, end);
+
+        pool_free(device_panel, queue);
+        #ifndef SYCL_EXT_ONEAPI_MEMCPY2D
+        pool_free(host_panel, queue);
+        #endif
+        stats.print();
+        std::cout << "-- Operations per second : "<<2.0*M*N*K/1024.0/1024.0/1024.0/stats.wall<<" Gops\n";
+    }
+
+    #ifdef __MODE_DEBUG_TIME__
+    check_result(A, B, C);
+    #endif
+
+
+    /********************************************************
+     *  Multi-device partitioning : split by C row blocks
+     *  - Device d computes C[begin:end,:] = A[begin:end,:] * B, so every device holds the whole B
+     ********************************************************/
+    std::cout << "\nMulti-device matmul (partitioned by C row blocks)\n";
+    {
+        MultiDeviceExecutor executor;
+
+        // Weight the devices with a small matmul instead of the default bandwidth kernel
+        executor.calibrate([](sycl::queue& q) {
+            const size_t n = 1024;
+            DTYPE* buffer = pool_malloc_device<DTYPE>(3*n*n, q);
+            q.fill(buffer, (DTYPE)1, 2*n*n).wait();
+            matmul_local_memory(q, buffer, buffer+n*n, buffer+2*n*n, n, n, n);
+            pool_free(buffer, q);
+        });
+        executor.print_devices();
+
+        const size_t num = executor.num_devices();
+        std::vector<DTYPE*> part_A(num), part_B(num), part_C(num);
+        double base_time = 0;
+
+        for (size_t num_devices=1; num_devices<=num; num_devices++) {
+
+            executor.use_devices(num_devices);
+            auto parts = executor.partition(M, 16);
+
+            // Scatter
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                size_t p = part.index;
+                part_A[p] = pool_malloc_device<DTYPE>(part.size()*K, q);
+                part_B[p] = pool_malloc_device<DTYPE>((size_t)K*N, q);
+                part_C[p] = pool_malloc_device<DTYPE>(part.size()*N, q);
+                q.memcpy(part_A[p], A.data()+part.begin*K, part.size()*K*sizeof(DTYPE));
+                q.memcpy(part_B[p], B.data(), (size_t)K*N*sizeof(DTYPE));
+                q.wait();
+            });
+
+            gettimeofday(&start, NULL);
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                size_t p = part.index;
+                for (int test=0; test<NUM_TESTS; test++)
+                    matmul_local_memory(q, part_A[p], part_B[p], part_C[p], part.size(), N, K);
+            });
+            gettimeofday(&end, NULL);
+
+            // Gather
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                size_t p = part.index;
+                q.memcpy(C.data()+part.begin*N, part_C[p], part.size()*N*sizeof(DTYPE)).wait();
+                pool_free(part_A[p], q);
+                pool_free(part_B[p], q);
+                pool_free(part_C[p], q);
+            });
+
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            if (num_devices == 1) base_time = time;
+            std::cout << "- "<<num_devices<<" device(s)\n";
+            std::cout << "-- Elasped time : "<<time<<" s (speedup "<<base_time/time<<"x)\n";
+            std::cout << "-- Operations per second : "<<2.0*M*N*K/1024.0/1024.0/1024.0/time<<" Gops\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            check_result(A, B, C);
+            #endif
+        }
+    }
+
+
     /********************************************************
      *  Finalize
      ********************************************************/
-    sycl::free (device_A, queue);
-    sycl::free (device_B, queue);
-    sycl::free (device_C, queue);
+    MemoryPool::instance().print_stats();
+    MemoryPool::instance().release();
     return 0;
 
     return 0;
@@ -117,23 +565,16 @@ int main(void) {
 
 void check_result(const std::vector<DTYPE>& A, const std::vector<DTYPE>& B, const std::vector<DTYPE>& C) {
     
-    DTYPE sum;
-    int m, n, k;
-    for (m=0; m<M; m++) {
-        for (n=0; n<N; n++) {
-            
-            sum = 0;
-            for (k=0; k<K; k++)
-                sum += A[m*K+k]*B[k*N+n];
-
-            // Check result
-            if (C[m*N+n] != sum) {
-                std::cout << "--- [[[ERROR]]] Checking the result failed at ["<<m<<","<<n<<"], gt("<<sum<<") != result("<<C[m*N+n]<<") !!\n";
-                return ;
-            }
+    // Freivalds' check is O(n^2), so every production-size run can be validated
+    if (matmul_freivalds(A.data(), B.data(), C.data(), M, N, K))
+        return;
 
-        }
-    }
-            
-    std::cout << "--- Checking the result succeed!!\n";
+    // Locate a wrong entry with a random spot check
+    validate_sampled((size_t)M*N, 4096, [&](size_t i) {
+        size_t m = i/N, n = i%N;
+        DTYPE sum = 0;
+        for (size_t k=0; k<K; k++)
+            sum += A[m*K+k]*B[k*N+n];
+        return sum;
+    }, C.data(), N);
 }
\ No newline at end of file
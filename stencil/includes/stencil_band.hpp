@@ -0,0 +1,89 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <CL/sycl.hpp>
+namespace sycl=cl::sycl;
+#include "../../common/autotune.hpp"
+#include "../../common/roofline.hpp"
+
+/********************************************************
+ *  Roofline cost shared by the stencil kernels
+ *  - Every [local_y,local_x] work-group reads its tile, the halo of K_HALF around it and the kernel
+ *  - One multiply and one add per kernel tap
+ ********************************************************/
+template<int K_SIZE>
+KernelCost stencil_cost(const size_t rows, const size_t cols, const size_t local_y=16, const size_t local_x=16) {
+    double groups = (double)((rows+local_y-1)/local_y)*((cols+local_x-1)/local_x);
+    double footprint = (double)(local_y+K_SIZE-1)*(local_x+K_SIZE-1)+K_SIZE*K_SIZE;
+    return KernelCost{sizeof(DTYPE)*groups*footprint, (double)sizeof(DTYPE)*rows*cols, 2.0*K_SIZE*K_SIZE*rows*cols};
+}
+
+
+/********************************************************
+ *  Stencil over a band of rows (used by the chunked drivers)
+ *  - in holds in_rows rows of cols elements, the first halo_top rows are the halo above the band
+ *  - out holds rows rows : out row y is centered on in row y+halo_top
+ *  - Rows outside of in are zero padding, so a band at the matrix border simply has no halo there
+ *  - The work-group shape [local_y, local_x] is a runtime parameter (see stencil_auto)
+ ********************************************************/
+template<int K_SIZE>
+sycl::event stencil_band(sycl::queue& queue, const DTYPE* in, const DTYPE* kernel, DTYPE* out, const int in_rows, const int halo_top, const int rows, const int cols,
+                         const size_t local_y=16, const size_t local_x=16) {
+
+    const int K_HALF=K_SIZE/2;
+    const size_t ceil_rows = ((rows+local_y-1)/local_y)*local_y;
+    const size_t ceil_cols = ((cols+local_x-1)/local_x)*local_x;
+
+    return queue.submit([&] (sycl::handler& cgh){
+
+        sycl::accessor<DTYPE, 2, sycl::access::mode::read_write, sycl::access::target::local> local_kernel(sycl::range<2>(K_SIZE,K_SIZE), cgh);
+        cgh.parallel_for(sycl::nd_range<2>({ceil_rows,ceil_cols}, {local_y, local_x}), [=](sycl::nd_item<2> item) {
+
+            int x = item.get_global_id(1);
+            int y = item.get_global_id(0);
+
+            int ky, kx;
+
+            // Any work-group shape can load the kernel : strided over the linear local id
+            for (int i=item.get_local_linear_id(); i<K_SIZE*K_SIZE; i+=local_y*local_x) {
+                local_kernel[i/K_SIZE][i%K_SIZE] = kernel[i];
+            }
+            item.barrier(sycl::access::fence_space::local_space);
+
+            if (y<rows && x<cols) {
+                int in_y = y+halo_top;
+                DTYPE sum=0;
+                for (ky=-K_HALF; ky<=K_HALF; ky++) {
+                    for (kx=-K_HALF; kx<=K_HALF; kx++) {
+                        if (0<=x+kx && x+kx<cols && 0<=in_y+ky && in_y+ky<in_rows) {
+                            sum += in[(in_y+ky)*cols+x+kx] * local_kernel[(ky+K_HALF)][(kx+K_HALF)];
+                        }
+                    }
+                }
+                out[y*cols+x] = sum;
+            }
+        });
+    });
+}
+
+
+/*** Tuned configuration : {local_y, local_x} for the whole [N,N] matrix ***/
+template<int K_SIZE>
+void stencil_auto(sycl::queue& queue, const DTYPE* in, const DTYPE* kernel, DTYPE* out) {
+
+    size_t max_local = queue.get_device().get_info<sycl::info::device::max_work_group_size>();
+    auto space = tuning_space({{4, 8, 16, 32}, {8, 16, 32, 64}}, [&](const TuningConfig& c) {
+        return c[0]*c[1] >= 64 && (size_t)(c[0]*c[1]) <= max_local;
+    });
+
+    std::string primitive = "stencil_k"+std::to_string(K_SIZE);
+    TuningConfig config = autotune(tuning_key<DTYPE>(primitive, queue, (size_t)N*N), space, [&](const TuningConfig& c) {
+        stencil_band<K_SIZE>(queue, in, kernel, out, N, 0, N, N, c[0], c[1]).wait();
+    });
+
+    stencil_band<K_SIZE>(queue, in, kernel, out, N, 0, N, N, config[0], config[1]);
+    queue.wait();
+}
+
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include "../../fft/includes/fft_2d.hpp"
+#include "stencil_band.hpp"
+
+
+/********************************************************
+ *  Direct or FFT convolution
+ *  - Direct : 2 K^2 operations per output
+ *  - FFT : forward and inverse 2D FFT of the padded [P,Q] matrix (the plan and the kernel spectrum are
+ *    set up once per kernel and size, see StencilFFTCache),
+ *    5 PQ log2(PQ) flops each, weighted by STENCIL_FFT_COST_FACTOR since the FFT passes are bandwidth bound
+ *  - The K sweep of stencil.cpp reports the measured crossover to adjust the factor
+ ********************************************************/
+constexpr double STENCIL_FFT_COST_FACTOR = 2.0;
+
+inline bool stencil_use_fft(const int k_size, const int rows, const int cols) {
+    double P = (double)fft_good_size(rows+k_size/2);
+    double Q = (double)fft_good_size(cols+k_size/2);
+    double direct = 2.0*k_size*k_size*rows*cols;
+    double fft = STENCIL_FFT_COST_FACTOR*2*5.0*P*Q*std::log2(P*Q);
+    return fft < direct;
+}
+
+
+/********************************************************
+ *  FFT convolution backend of the stencil : out = in (*) kernel with zero padding, [rows,cols] matrices
+ *  - in is zero-padded to [P,Q] = [rows+K/2, cols+K/2] rounded up to 2^a 3^b 5^c, so the circular
+ *    correlation never wraps the far border onto a valid output
+ *  - The correlation kernel g[(-dy) mod P][(-dx) mod Q] = kernel[dy+K/2][dx+K/2] is transformed once
+ *  - run : pack, forward FFT, pointwise product scaled by 1/PQ, inverse FFT, unpack
+ *    (integer DTYPE is rounded to the nearest value, exact as long as R carries enough precision)
+ ********************************************************/
+template <typename R>
+class StencilFFT {
+
+    public:
+        StencilFFT(sycl::queue& queue, const DTYPE* kernel, const int k_size, const int rows, const int cols)
+            : rows(rows), cols(cols), P(fft_good_size(rows+k_size/2)), Q(fft_good_size(cols+k_size/2)), fft(queue, P, Q) {
+
+            sycl::queue& stream = fft.queue();
+            spectrum = pool_malloc_device<Complex<R>>(P*Q, stream);
+            signal = pool_malloc_device<Complex<R>>(P*Q, stream);
+
+            Complex<R>* g = spectrum;
+            const size_t P = this->P, Q = this->Q;
+            const int K_HALF = k_size/2;
+            stream.memset(g, 0, sizeof(Complex<R>)*P*Q);
+            stream.submit([&] (sycl::handler& cgh) {
+                cgh.parallel_for(sycl::range<1>(k_size*k_size), [=](sycl::item<1> item) {
+                    int i = item.get_linear_id();
+                    int dy = i/k_size-K_HALF;
+                    int dx = i%k_size-K_HALF;
+                    g[((P-dy)%P)*Q+(Q-dx)%Q] = Complex<R>{(R)kernel[i], 0};
+                });
+            });
+            fft.forward(g).wait();
+        }
+
+        ~StencilFFT() {
+            fft.queue().wait();
+            pool_free(spectrum, fft.queue());
+            pool_free(signal, fft.queue());
+        }
+
+        StencilFFT(const StencilFFT&) = delete;
+        StencilFFT& operator=(const StencilFFT&) = delete;
+
+        size_t padded_rows() const { return P; }
+        size_t padded_cols() const { return Q; }
+
+        // in must be ready when run() is called, wait on the returned event
+        sycl::event run(const DTYPE* in, DTYPE* out) {
+
+            sycl::queue& stream = fft.queue();
+            Complex<R>* signal = this->signal;
+            const Complex<R>* spectrum = this->spectrum;
+            const size_t P = this->P, Q = this->Q;
+            const int rows = this->rows, cols = this->cols;
+
+            // Pack with zero padding
+            stream.submit([&] (sycl::handler& cgh) {
+                cgh.parallel_for(sycl::range<2>(P, Q), [=](sycl::item<2> item) {
+                    size_t y = item.get_id(0);
+                    size_t x = item.get_id(1);
+                    R value = (y<rows && x<cols) ? (R)in[y*cols+x] : (R)0;
+                    signal[y*Q+x] = Complex<R>{value, 0};
+                });
+            });
+            fft.forward(signal);
+
+            // Both spectra share the transposed layout, so the product is element-wise
+            const R scale = (R)1/((R)P*(R)Q);
+            stream.submit([&] (sycl::handler& cgh) {
+                cgh.parallel_for(sycl::range<1>(P*Q), [=](sycl::item<1> item) {
+                    size_t i = item.get_linear_id();
+                    Complex<R> product = signal[i]*spectrum[i];
+                    signal[i] = Complex<R>{product.re*scale, product.im*scale};
+                });
+            });
+            fft.inverse(signal);
+
+            return stream.submit([&] (sycl::handler& cgh) {
+                cgh.parallel_for(sycl::range<2>(rows, cols), [=](sycl::item<2> item) {
+                    size_t y = item.get_id(0);
+                    size_t x = item.get_id(1);
+                    R value = signal[y*Q+x].re;
+                    if constexpr (std::is_integral<DTYPE>::value) out[y*cols+x] = (DTYPE)sycl::rint(value);
+                    else out[y*cols+x] = (DTYPE)value;
+                });
+            });
+        }
+
+
+    private:
+        int rows, cols;
+        size_t P, Q;
+        FFT2D<R> fft;
+        Complex<R>* spectrum;
+        Complex<R>* signal;
+};
+
+
+/********************************************************
+ *  StencilFFT instances of stencil_select, one per (kernel, K, rows, cols)
+ *  - The FFT plan, buffers and kernel spectrum are set up on the first call only, later calls just run(),
+ *    which is the cost stencil_use_fft models
+ *  - kernel is a USM device pointer, so it also pins the device; release() before freeing or updating
+ *    a kernel in place (its pointer may come back from the pool for another kernel), and before
+ *    MemoryPool::release() since the instances hold pool blocks
+ ********************************************************/
+class StencilFFTCache {
+
+    public:
+        static StencilFFTCache& instance() {
+            static StencilFFTCache cache;
+            return cache;
+        }
+
+        StencilFFT<double>& get(sycl::queue& queue, const DTYPE* kernel, const int k_size, const int rows, const int cols) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::unique_ptr<StencilFFT<double>>& conv = instances[std::make_tuple(kernel, k_size, rows, cols)];
+            if (!conv) conv.reset(new StencilFFT<double>(queue, kernel, k_size, rows, cols));
+            return *conv;
+        }
+
+        void release() {
+            std::lock_guard<std::mutex> lock(mutex);
+            instances.clear();
+        }
+
+    private:
+        StencilFFTCache() {}
+
+        std::mutex mutex;
+        std::map<std::tuple<const DTYPE*, int, int, int>, std::unique_ptr<StencilFFT<double>>> instances;
+};
+
+
+/********************************************************
+ *  Stencil entry point over a [rows,cols] matrix : direct tiled kernel or FFT convolution (stencil_use_fft)
+ *  - The FFT path works in double, exact for integer DTYPE; a float spectrum cannot hold the exact sums
+ *    (24-bit mantissa), so devices without fp64 always use the direct kernel
+ ********************************************************/
+template<int K_SIZE>
+void stencil_select(sycl::queue& queue, const DTYPE* in, const DTYPE* kernel, DTYPE* out, const int rows, const int cols) {
+
+    if (!queue.get_device().has(sycl::aspect::fp64) || !stencil_use_fft(K_SIZE, rows, cols)) {
+        stencil_band<K_SIZE>(queue, in, kernel, out, rows, 0, rows, cols).wait();
+        return;
+    }
+
+    StencilFFT<double>& conv = StencilFFTCache::instance().get(queue, kernel, K_SIZE, rows, cols);
+    queue.wait();
+    conv.run(in, out).wait();
+}
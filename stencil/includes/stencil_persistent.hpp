@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../../common/persistent.hpp"
+#include "stencil_band.hpp"
+
+
+/********************************************************
+ *  Persistent stencil over a [rows,cols] matrix (zero padding outside)
+ *  - A device-sized grid of TILE_Y x TILE_X work-groups loops over the output tiles
+ *    (grid-stride or atomic work queue, see common/persistent.hpp)
+ *  - The kernel is loaded into local memory once per work-group instead of once per tile
+ *  - launch_per_element falls back to stencil_band, one workitem per output element
+ ********************************************************/
+template<int K_SIZE, size_t TILE_Y=16, size_t TILE_X=16>
+sycl::event stencil_persistent(sycl::queue& queue, const DTYPE* in, const DTYPE* kernel, DTYPE* out, const int rows, const int cols, Schedule schedule) {
+
+    if (schedule == Schedule::launch_per_element)
+        return stencil_band<K_SIZE>(queue, in, kernel, out, rows, 0, rows, cols, TILE_Y, TILE_X);
+
+    const int K_HALF=K_SIZE/2;
+    const size_t tiles_x = (cols+TILE_X-1)/TILE_X;
+    const size_t num_tiles = ((rows+TILE_Y-1)/TILE_Y)*tiles_x;
+
+    return persistent_launch(queue, schedule, TILE_Y*TILE_X, num_tiles, [&](sycl::handler& cgh, size_t num_groups, unsigned int* counter) {
+
+        sycl::accessor<DTYPE, 2, sycl::access::mode::read_write, sycl::access::target::local> local_kernel(sycl::range<2>(K_SIZE,K_SIZE), cgh);
+        cgh.parallel_for(sycl::nd_range<1>(num_groups*TILE_Y*TILE_X, TILE_Y*TILE_X), [=](sycl::nd_item<1> item) {
+
+            int ly = item.get_local_id(0)/TILE_X;
+            int lx = item.get_local_id(0)%TILE_X;
+
+            for (int i=item.get_local_id(0); i<K_SIZE*K_SIZE; i+=TILE_Y*TILE_X) {
+                local_kernel[i/K_SIZE][i%K_SIZE] = kernel[i];
+            }
+            item.barrier(sycl::access::fence_space::local_space);
+
+            persistent_for(item, num_tiles, counter, [&](size_t tile) {
+
+                int y = (tile/tiles_x)*TILE_Y+ly;
+                int x = (tile%tiles_x)*TILE_X+lx;
+                if (y<rows && x<cols) {
+                    DTYPE sum=0;
+                    for (int ky=-K_HALF; ky<=K_HALF; ky++) {
+                        for (int kx=-K_HALF; kx<=K_HALF; kx++) {
+                            if (0<=x+kx && x+kx<cols && 0<=y+ky && y+ky<rows) {
+                                sum += in[(y+ky)*cols+x+kx] * local_kernel[(ky+K_HALF)][(kx+K_HALF)];
+                            }
+                        }
+                    }
+                    out[y*cols+x] = sum;
+                }
+            });
+        });
+    });
+}
@@ -1,8 +1,13 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstring>
 #include <CL/sycl.hpp>
 namespace sycl=cl::sycl;
+#include "../common/memory_pool.hpp"
+#include "../common/device_select.hpp"
+#include "../common/roofline.hpp"
+#include "../common/validation.hpp"
 
 /*** Measure performance ***/
 #include <sys/time.h>
@@ -11,25 +16,100 @@ timeval start, end;
 
 /*** Data configuration ***/
 #define DTYPE long
+#ifdef __MODE_SMALL_PROBLEM__
+constexpr int N=1024*2;
+#else
 constexpr int N=1024*5;
+#endif
 constexpr int KERNEL_SIZE=3;
 
+/*** Streaming configuration ***/
+constexpr int STREAM_ROWS=N/8;
+const size_t NUM_STREAMS=3;
+
+/*** Direct vs FFT convolution : kernel sizes of the sweep ***/
+constexpr int MAX_KERNEL_SIZE=31;
+
+/*** Record and replay configuration ***/
+const int NUM_REPLAYS=200;
+
 /*** Debugging info ***/
 #define __MODE_DEBUG_TIME__
 const int NUM_TESTS=20;
-void check_result(const std::vector<DTYPE>&,const std::vector<DTYPE>&,const std::vector<DTYPE>&);
+void check_result(const std::vector<DTYPE>&,const std::vector<DTYPE>&,const std::vector<DTYPE>&,const int n=N,const int k_size=KERNEL_SIZE);
 
 /*** Parallel algorithm implementations ***/
 #include "includes/stencil_naive.hpp"
 #include "includes/stencil_local_memory.hpp"
+#include "includes/stencil_band.hpp"
+#include "includes/stencil_persistent.hpp"
+#include "includes/stencil_fft.hpp"
+#include "../common/streaming.hpp"
+#include "../common/mapped_file.hpp"
+#include "../common/multi_device.hpp"
+#include "../common/graph.hpp"
+
+
+
+/********************************************************
+ *  Direct tiled stencil vs FFT convolution with a K_SIZE x K_SIZE kernel over the whole [N,N] matrix
+ *  - Returns the FFT speedup over the direct kernel
+ *  - Without fp64 the FFT runs in float for timing only : its rounded result is not exact, so it is not checked
+ ********************************************************/
+template<int K_SIZE>
+double compare_direct_fft(sycl::queue& queue, const std::vector<DTYPE>& in, const DTYPE* device_in, const std::vector<DTYPE>& kernel,
+                          const DTYPE* device_kernel, std::vector<DTYPE>& out, DTYPE* device_out) {
+
+    stencil_band<K_SIZE>(queue, device_in, device_kernel, device_out, N, 0, N, N).wait();    // warming up
+    gettimeofday(&start, NULL);
+    for (int test=0; test<NUM_TESTS; test++){
+        stencil_band<K_SIZE>(queue, device_in, device_kernel, device_out, N, 0, N, N).wait();
+    }
+    gettimeofday(&end, NULL);
+    double direct_time = ELAPSED_TIME(start, end)/NUM_TESTS;
+
+    double fft_time;
+    size_t P, Q;
+    auto time_fft = [&](auto& conv) {
+        P = conv.padded_rows();
+        Q = conv.padded_cols();
+        conv.run(device_in, device_out).wait();    // warming up
+        gettimeofday(&start, NULL);
+        for (int test=0; test<NUM_TESTS; test++){
+            conv.run(device_in, device_out).wait();
+        }
+        gettimeofday(&end, NULL);
+        fft_time = ELAPSED_TIME(start, end)/NUM_TESTS;
+    };
+    const bool fp64 = queue.get_device().has(sycl::aspect::fp64);
+    if (fp64) {
+        StencilFFT<double> conv(queue, device_kernel, K_SIZE, N, N);
+        time_fft(conv);
+    } else {
+        StencilFFT<float> conv(queue, device_kernel, K_SIZE, N, N);
+        time_fft(conv);
+    }
+
+    std::cout << "- "<<K_SIZE<<"x"<<K_SIZE<<" kernel (FFT size "<<P<<"x"<<Q<<", model picks "<<(fp64 && stencil_use_fft(K_SIZE, N, N) ? "FFT" : "direct")<<")\n";
+    std::cout << "-- direct : "<<direct_time<<" s, FFT : "<<fft_time<<" s (FFT speedup "<<direct_time/fft_time<<"x)\n";
 
+    #ifdef __MODE_DEBUG_TIME__
+    if (fp64) {
+        queue.memcpy(out.data(), device_out, N*N*sizeof(DTYPE));
+        queue.wait();
+        check_result(in, kernel, out, N, K_SIZE);
+    } else std::cout << "-- [[[WARNING]]] No fp64 on the device : float FFT timed only, its result is not exact and not checked\n";
+    #endif
+
+    return direct_time/fft_time;
+}
 
 
-int main(void) {
+int main(int argc, char* argv[]) {
 
     std::cout << "=================================================\n";
     std::cout << "SYCL Primitives : Parallel 2D Matrix Stencil\n";
-    std::cout << "-- a single nvidia GPU example\n";
+    std::cout << "-- a single device example (--device=<gpu|cpu|acc|index|name>)\n";
     std::cout << "-- 2D Matrix : in["<<N<<","<<N<<"] with kernel["<<KERNEL_SIZE<<","<<KERNEL_SIZE<<"] and zero padding -> "<<"out["<<N<<","<<N<<"]\n";
     std::cout << "-- 2D Matrix size: "<<sizeof(DTYPE)*N*N/1024.0/1024.0/1024.0<<" GB\n";
     std::cout << "=================================================\n\n";
@@ -37,8 +117,9 @@ int main(void) {
     /********************************************************
      *  SYCL setup
      ********************************************************/
-    sycl::gpu_selector device;
-    sycl::queue queue(device);
+    sycl::queue queue(select_device(argc, argv));
+    std::cout << "Running on "<<queue.get_device().get_info<sycl::info::device::name>()<<"\n";
+    measure_roof<DTYPE>(queue);    // one-time bandwidth and compute roof of the device
 
     /********************************************************
      *  Data initilzation
@@ -46,19 +127,19 @@ int main(void) {
     // Input data
     std::vector<DTYPE> in(N*N);
     std::generate(in.begin(), in.end(), [](){return (std::rand()%10-5);});
-    DTYPE* device_in = sycl::malloc_device<DTYPE>(N*N, queue);
+    DTYPE* device_in = pool_malloc_device<DTYPE>(N*N, queue);
     queue.memcpy(device_in, in.data(), N*N*sizeof(DTYPE));
 
     // Kernel data
     std::vector<DTYPE> kernel(KERNEL_SIZE*KERNEL_SIZE);
     std::generate(kernel.begin(), kernel.end(), [](){return (std::rand()%10-5);});
-    DTYPE* device_kernel = sycl::malloc_device<DTYPE>(KERNEL_SIZE*KERNEL_SIZE, queue);
+    DTYPE* device_kernel = pool_malloc_device<DTYPE>(KERNEL_SIZE*KERNEL_SIZE, queue);
     queue.memcpy(device_kernel, kernel.data(), KERNEL_SIZE*KERNEL_SIZE*sizeof(DTYPE));
 
 
     // Output data
     std::vector<DTYPE> out(N*N);
-    DTYPE* device_out = sycl::malloc_device<DTYPE>(N*N, queue);
+    DTYPE* device_out = pool_malloc_device<DTYPE>(N*N, queue);
 
     // For initial warming up
     stencil_naive<KERNEL_SIZE>(queue, device_in, device_kernel, device_out);
@@ -76,9 +157,7 @@ int main(void) {
         stencil_naive<KERNEL_SIZE>(queue, device_in, device_kernel, device_out);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*N*N/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
-    std::cout << "-- Multiplications per second : "<<KERNEL_SIZE*KERNEL_SIZE*N*N/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" Gops\n";
+    roofline_report<DTYPE>(queue, stencil_cost<KERNEL_SIZE>(N, N), ELAPSED_TIME(start, end)/NUM_TESTS);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(out.data(), device_out, N*N*sizeof(DTYPE));
@@ -97,9 +176,7 @@ int main(void) {
         stencil_local_memory<KERNEL_SIZE>(queue, device_in, device_kernel, device_out);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*N*N/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
-    std::cout << "-- Multiplications per second : "<<KERNEL_SIZE*KERNEL_SIZE*N*N/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" Gops\n";
+    roofline_report<DTYPE>(queue, stencil_cost<KERNEL_SIZE>(N, N), ELAPSED_TIME(start, end)/NUM_TESTS);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(out.data(), device_out, N*N*sizeof(DTYPE));
@@ -109,44 +186,380 @@ int main(void) {
 
 
 
+    /********************************************************
+     *  Auto-tuned implementation : work-group shape
+     ********************************************************/
+    std::cout << "\nAuto-tuned parallel stencil (tuning cache : "<<TuningCache::instance().file()<<")\n";
+    stencil_auto<KERNEL_SIZE>(queue, device_in, device_kernel, device_out);    // tunes on the first call, then reads the cache
+    gettimeofday(&start, NULL);
+    for (int test=0; test<NUM_TESTS; test++){
+        stencil_auto<KERNEL_SIZE>(queue, device_in, device_kernel, device_out);
+    }
+    gettimeofday(&end, NULL);
+    roofline_report<DTYPE>(queue, stencil_cost<KERNEL_SIZE>(N, N), ELAPSED_TIME(start, end)/NUM_TESTS);
+
+    #ifdef __MODE_DEBUG_TIME__
+    queue.memcpy(out.data(), device_out, N*N*sizeof(DTYPE));
+    queue.wait();
+    check_result(in, kernel, out);
+    #endif
+
+
+
+    /********************************************************
+     *  Persistent stencil vs launch per element across problem sizes
+     ********************************************************/
+    std::cout << "\nPersistent stencil (device-sized grid) vs launch per element\n";
+    for (int n : {N/8, N/4, N/2, N}) {
+        std::cout << "- "<<n<<"x"<<n<<" matrix\n";
+        for (Schedule schedule : {Schedule::launch_per_element, Schedule::grid_stride, Schedule::work_queue}) {
+            stencil_persistent<KERNEL_SIZE>(queue, device_in, device_kernel, device_out, n, n, schedule).wait();    // warming up
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++){
+                stencil_persistent<KERNEL_SIZE>(queue, device_in, device_kernel, device_out, n, n, schedule).wait();
+            }
+            gettimeofday(&end, NULL);
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            std::cout << "-- "<<schedule_name(schedule)<<" : "<<time<<" s, "<<stencil_cost<KERNEL_SIZE>(n, n).ops/1024.0/1024.0/1024.0/time<<" Gops\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            if (n == N) {
+                queue.memcpy(out.data(), device_out, N*N*sizeof(DTYPE));
+                queue.wait();
+                check_result(in, kernel, out);
+            }
+            #endif
+        }
+    }
+
+
+
+    /********************************************************
+     *  Direct vs FFT convolution over kernel sizes
+     *  - Crossover : smallest kernel size where the FFT convolution beats the direct kernel
+     ********************************************************/
+    std::cout << "\nDirect stencil vs FFT convolution\n";
+    {
+        std::vector<DTYPE> large_kernel(MAX_KERNEL_SIZE*MAX_KERNEL_SIZE);
+        std::generate(large_kernel.begin(), large_kernel.end(), [](){return (std::rand()%10-5);});
+        DTYPE* device_large_kernel = pool_malloc_device<DTYPE>(MAX_KERNEL_SIZE*MAX_KERNEL_SIZE, queue);
+        queue.memcpy(device_large_kernel, large_kernel.data(), MAX_KERNEL_SIZE*MAX_KERNEL_SIZE*sizeof(DTYPE)).wait();
+
+        // The leading K x K elements of large_kernel are the K x K kernel
+        std::vector<int> sizes = {3, 7, 15, 31};
+        std::vector<double> speedups = {
+            compare_direct_fft<3>(queue, in, device_in, large_kernel, device_large_kernel, out, device_out),
+            compare_direct_fft<7>(queue, in, device_in, large_kernel, device_large_kernel, out, device_out),
+            compare_direct_fft<15>(queue, in, device_in, large_kernel, device_large_kernel, out, device_out),
+            compare_direct_fft<31>(queue, in, device_in, large_kernel, device_large_kernel, out, device_out)};
+
+        int crossover = 0;
+        for (size_t i=0; i<sizes.size() && crossover==0; i++)
+            if (speedups[i] > 1.0) crossover = sizes[i];
+        if (crossover == 0) std::cout << "-- Crossover kernel size : none up to "<<sizes.back()<<"x"<<sizes.back()<<" at N="<<N<<"\n";
+        else std::cout << "-- Crossover kernel size : "<<crossover<<"x"<<crossover<<" at N="<<N<<"\n";
+
+        // Entry point choosing by K and N
+        stencil_select<31>(queue, device_in, device_large_kernel, device_out, N, N);
+        #ifdef __MODE_DEBUG_TIME__
+        queue.memcpy(out.data(), device_out, N*N*sizeof(DTYPE));
+        queue.wait();
+        check_result(in, large_kernel, out, N, 31);
+        #endif
+
+        StencilFFTCache::instance().release();    // before the kernel its instance is keyed on is freed
+        pool_free(device_large_kernel, queue);
+    }
+
+
+
+    /********************************************************
+     *  Record and replay of a two-step pipeline : stencil into a scratch buffer, then copy out
+     *  - Iterations alternate between two output buffers, so the replay updates its pointers
+     ********************************************************/
+    std::cout << "\nRecorded pipeline replay vs re-submission ("<<NUM_REPLAYS<<" iterations)\n";
+    for (int n : {N/16, N/4}) {
+        RecordReplay replay(queue);
+        DTYPE* device_tmp = pool_malloc_device<DTYPE>(n*n, queue);
+
+        auto pipeline = [&](sycl::queue& q, int i) {
+            stencil_band<KERNEL_SIZE>(q, device_in, device_kernel, device_tmp, n, 0, n, n);
+            return q.memcpy(device_out+(i%2)*n*n, device_tmp, n*n*sizeof(DTYPE));
+        };
+
+        std::cout << "- "<<n<<"x"<<n<<" matrix ("<<(replay.is_native() ? "sycl_ext_oneapi_graph" : "no graph support, re-submission")<<")\n";
+        measure_submission(replay.queue(), NUM_REPLAYS, [&](int i) {
+            pipeline(replay.queue(), i);
+        }).print("re-submission");
+        measure_submission(replay.queue(), NUM_REPLAYS, [&](int i) {
+            replay.run({device_in, device_kernel, device_tmp, device_out+(i%2)*n*n}, [&](sycl::queue& q) { return pipeline(q, i); });
+        }).print("replay");
+        std::cout << "-- recorded graphs : "<<replay.num_graphs()<<"\n";
+
+        #ifdef __MODE_DEBUG_TIME__
+        queue.memcpy(out.data(), device_out, 2*n*n*sizeof(DTYPE));
+        queue.wait();
+        check_result(in, kernel, out, n);
+        validate((size_t)n*n, [&](size_t i) { return out[i]; }, out.data()+n*n, n);    // second output buffer
+        #endif
+
+        pool_free(device_tmp, queue);
+    }
+
+
+
+    /********************************************************
+     *  Multi-device partitioning : row bands with halo exchange
+     *  - Device d owns the rows [begin,end) and keeps K_HALF halo rows of each neighbour around them
+     ********************************************************/
+    std::cout << "\nMulti-device stencil (partitioned by row bands)\n";
+    {
+        const int K_HALF = KERNEL_SIZE/2;
+        MultiDeviceExecutor executor;
+        executor.calibrate();
+        executor.print_devices();
+
+        const size_t num = executor.num_devices();
+        std::vector<DTYPE*> part_in(num), part_kernel(num), part_out(num);
+        std::vector<int> halo_top(num), halo_bottom(num);
+        std::vector<std::vector<DTYPE>> first_rows(num), last_rows(num);
+        double base_time = 0;
+
+        for (size_t num_devices=1; num_devices<=num; num_devices++) {
+
+            executor.use_devices(num_devices);
+            auto parts = executor.partition(N, 16);
+
+            // Scatter the owned rows
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                size_t p = part.index;
+                halo_top[p] = part.begin>0 ? K_HALF : 0;
+                halo_bottom[p] = part.end<N ? K_HALF : 0;
+                part_in[p] = pool_malloc_device<DTYPE>((halo_top[p]+part.size()+halo_bottom[p])*N, q);
+                part_kernel[p] = pool_malloc_device<DTYPE>(KERNEL_SIZE*KERNEL_SIZE, q);
+                part_out[p] = pool_malloc_device<DTYPE>(part.size()*N, q);
+                q.memcpy(part_in[p]+halo_top[p]*N, in.data()+part.begin*N, part.size()*N*sizeof(DTYPE));
+                q.memcpy(part_kernel[p], kernel.data(), KERNEL_SIZE*KERNEL_SIZE*sizeof(DTYPE));
+                q.wait();
+            });
+
+            // Halo exchange 1/2 : every band publishes its first and last K_HALF owned rows
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                size_t p = part.index;
+                first_rows[p].resize(K_HALF*N);
+                last_rows[p].resize(K_HALF*N);
+                q.memcpy(first_rows[p].data(), part_in[p]+halo_top[p]*N, K_HALF*N*sizeof(DTYPE));
+                q.memcpy(last_rows[p].data(), part_in[p]+(halo_top[p]+part.size()-K_HALF)*N, K_HALF*N*sizeof(DTYPE));
+                q.wait();
+            });
+
+            // Halo exchange 2/2 : every band pulls the rows of the neighbours above and below
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                size_t p = part.index;
+                for (auto& other : parts) {
+                    if (other.size() == 0) continue;
+                    if (other.end == part.begin)
+                        q.memcpy(part_in[p], last_rows[other.index].data(), K_HALF*N*sizeof(DTYPE));
+                    if (other.begin == part.end)
+                        q.memcpy(part_in[p]+(halo_top[p]+part.size())*N, first_rows[other.index].data(), K_HALF*N*sizeof(DTYPE));
+                }
+                q.wait();
+                stencil_band<KERNEL_SIZE>(q, part_in[p], part_kernel[p], part_out[p], halo_top[p]+part.size()+halo_bottom[p], halo_top[p], part.size(), N).wait();    // warming up
+            });
+
+            gettimeofday(&start, NULL);
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                size_t p = part.index;
+                for (int test=0; test<NUM_TESTS; test++)
+                    stencil_band<KERNEL_SIZE>(q, part_in[p], part_kernel[p], part_out[p], halo_top[p]+part.size()+halo_bottom[p], halo_top[p], part.size(), N).wait();
+            });
+            gettimeofday(&end, NULL);
+
+            // Gather
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                size_t p = part.index;
+                q.memcpy(out.data()+part.begin*N, part_out[p], part.size()*N*sizeof(DTYPE)).wait();
+                pool_free(part_in[p], q);
+                pool_free(part_kernel[p], q);
+                pool_free(part_out[p], q);
+            });
+
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            if (num_devices == 1) base_time = time;
+            std::cout << "- "<<num_devices<<" device(s)\n";
+            std::cout << "-- Elasped time : "<<time<<" s (speedup "<<base_time/time<<"x)\n";
+            std::cout << "-- Operations per second : "<<stencil_cost<KERNEL_SIZE>(N, N).ops/1024.0/1024.0/1024.0/time<<" Gops\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            check_result(in, kernel, out);
+            #endif
+        }
+    }
+
+
+
+    /********************************************************
+     *  Out-of-core streaming : row bands with halo overlap
+     ********************************************************/
+    std::cout << "\nOut-of-core streaming stencil (bands of "<<STREAM_ROWS<<" rows, "<<NUM_STREAMS<<" streams)\n";
+    {
+        const int K_HALF = KERNEL_SIZE/2;
+        const int num_bands = (N+STREAM_ROWS-1)/STREAM_ROWS;
+        StreamingEngine<DTYPE> engine(queue, (STREAM_ROWS+2*K_HALF)*N, STREAM_ROWS*N, NUM_STREAMS);
+
+        // Band [row_begin, row_end) reads the input rows [in_begin, in_end), which include the halo of both neighbours
+        auto band = [&](size_t chunk, int& row_begin, int& row_end, int& in_begin, int& in_end) {
+            row_begin = chunk*STREAM_ROWS;
+            row_end = std::min(N, row_begin+STREAM_ROWS);
+            in_begin = std::max(0, row_begin-K_HALF);
+            in_end = std::min(N, row_end+K_HALF);
+        };
+
+        auto pack = [&](size_t chunk, DTYPE* staging_in) {
+            int row_begin, row_end, in_begin, in_end;
+            band(chunk, row_begin, row_end, in_begin, in_end);
+            std::memcpy(staging_in, in.data()+(size_t)in_begin*N, sizeof(DTYPE)*(in_end-in_begin)*N);
+            return StreamChunk{(size_t)(in_end-in_begin)*N, (size_t)(row_end-row_begin)*N};
+        };
+        auto launch = [&](sycl::queue& stream, size_t chunk, const DTYPE* d_in, DTYPE* d_out) {
+            int row_begin, row_end, in_begin, in_end;
+            band(chunk, row_begin, row_end, in_begin, in_end);
+            return stencil_band<KERNEL_SIZE>(stream, d_in, device_kernel, d_out, in_end-in_begin, row_begin-in_begin, row_end-row_begin, N);
+        };
+        auto unpack = [&](size_t chunk, const DTYPE* staging_out, size_t count) {
+            std::memcpy(out.data()+chunk*STREAM_ROWS*N, staging_out, count*sizeof(DTYPE));
+        };
+
+        engine.run(num_bands, pack, launch, unpack);    // warming up
+        StreamingStats stats = engine.run(num_bands, pack, launch, unpack);
+        stats.print();
+    }
+
+    #ifdef __MODE_DEBUG_TIME__
+    check_result(in, kernel, out);
+    #endif
+
+
+    /********************************************************
+     *  File ingestion : input file -> stencil -> output file, by row bands with halo
+     *  - read then memcpy : fread the whole file into a host vector, one H2D copy, stencil, one D2H copy, fwrite
+     *  - memory-mapped : every band (halo included) is a contiguous range of the input mapping and its result
+     *    a contiguous range of the output mapping, copied directly where the mappings can be registered
+     *  - A failed write, read or mapping is reported and skips the comparison
+     *  - The input was just written, so both read it from a warm page cache
+     ********************************************************/
+    std::cout << "\nFile ingestion : memory-mapped bands vs read then memcpy (bands of "<<STREAM_ROWS<<" rows)\n";
+    {
+        const std::string in_path = data_file_path("sycl_primitives_stencil_in.npy");
+        const std::string out_path = data_file_path("sycl_primitives_stencil_out.npy");
+        bool ok = npy_fwrite(in_path, in.data(), {(size_t)N, (size_t)N});
+
+        gettimeofday(&start, NULL);
+        ok = ok && npy_fread(in_path, out.data(), (size_t)N*N);
+        if (ok) {
+            queue.memcpy(device_in, out.data(), N*N*sizeof(DTYPE)).wait();
+            stencil_band<KERNEL_SIZE>(queue, device_in, device_kernel, device_out, N, 0, N, N).wait();
+            queue.memcpy(out.data(), device_out, N*N*sizeof(DTYPE)).wait();
+        }
+        ok = ok && npy_fwrite(out_path, out.data(), {(size_t)N, (size_t)N});
+        gettimeofday(&end, NULL);
+        double baseline_time = ELAPSED_TIME(start, end);
+
+        bool direct = false;
+        gettimeofday(&start, NULL);
+        if (ok) {
+            MappedFile input = MappedFile::open<DTYPE>(in_path, (size_t)N*N);
+            MappedFile output = MappedFile::create<DTYPE>(out_path, {(size_t)N, (size_t)N});
+            ok = input.is_open() && output.is_open();
+            direct = ok && input.register_for_device_copy(queue) && output.register_for_device_copy(queue);
+            const DTYPE* file_in = input.data<DTYPE>();
+            DTYPE* file_out = output.data<DTYPE>();
+
+            const int K_HALF = KERNEL_SIZE/2;
+            const int num_bands = (N+STREAM_ROWS-1)/STREAM_ROWS;
+            StreamingEngine<DTYPE> engine(queue, (STREAM_ROWS+2*K_HALF)*N, STREAM_ROWS*N, NUM_STREAMS);
+
+            auto band = [&](size_t chunk, int& row_begin, int& row_end, int& in_begin, int& in_end) {
+                row_begin = chunk*STREAM_ROWS;
+                row_end = std::min(N, row_begin+STREAM_ROWS);
+                in_begin = std::max(0, row_begin-K_HALF);
+                in_end = std::min(N, row_end+K_HALF);
+            };
+
+            auto pack = [&](size_t chunk, DTYPE* staging_in) {
+                int row_begin, row_end, in_begin, in_end;
+                band(chunk, row_begin, row_end, in_begin, in_end);
+                size_t in_count = (size_t)(in_end-in_begin)*N, out_count = (size_t)(row_end-row_begin)*N;
+                input.prefetch((size_t)in_end*N*sizeof(DTYPE), (size_t)STREAM_ROWS*N*sizeof(DTYPE));
+                if (direct) return StreamChunk{in_count, out_count, file_in+(size_t)in_begin*N, file_out+(size_t)row_begin*N};
+                std::memcpy(staging_in, file_in+(size_t)in_begin*N, sizeof(DTYPE)*in_count);
+                return StreamChunk{in_count, out_count};
+            };
+            auto launch = [&](sycl::queue& stream, size_t chunk, const DTYPE* d_in, DTYPE* d_out) {
+                int row_begin, row_end, in_begin, in_end;
+                band(chunk, row_begin, row_end, in_begin, in_end);
+                return stencil_band<KERNEL_SIZE>(stream, d_in, device_kernel, d_out, in_end-in_begin, row_begin-in_begin, row_end-row_begin, N);
+            };
+            auto unpack = [&](size_t chunk, const DTYPE* staging_out, size_t count) {
+                if (!direct) std::memcpy(file_out+chunk*STREAM_ROWS*N, staging_out, count*sizeof(DTYPE));
+            };
+            if (ok) engine.run(num_bands, pack, launch, unpack);
+        }
+        gettimeofday(&end, NULL);
+        double mapped_time = ELAPSED_TIME(start, end);
+
+        if (!ok) std::cout << "--- [[[ERROR]]] File I/O failed, skipping the file ingestion comparison !!\n";
+        else {
+            double file_bytes = 2.0*sizeof(DTYPE)*N*N;
+            std::cout << "- read then memcpy : "<<baseline_time<<" s, "<<file_bytes/1024.0/1024.0/1024.0/baseline_time<<" GB/s file to file\n";
+            std::cout << "- memory-mapped ("<<(direct ? "registered, direct copies" : "staged through pinned buffers")<<") : "
+                      <<mapped_time<<" s, "<<file_bytes/1024.0/1024.0/1024.0/mapped_time<<" GB/s file to file (speedup "<<baseline_time/mapped_time<<"x)\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            MappedFile result = MappedFile::open<DTYPE>(out_path, (size_t)N*N);
+            if (result.is_open()) {
+                std::copy(result.data<DTYPE>(), result.data<DTYPE>()+(size_t)N*N, out.begin());
+                check_result(in, kernel, out);
+            }
+            #endif
+        }
+
+        std::remove(in_path.c_str());
+        std::remove(out_path.c_str());
+    }
+
+
+
 
     /********************************************************
      *  Finalize
      ********************************************************/
-    sycl::free (device_in, queue);
-    sycl::free (device_kernel, queue);
-    sycl::free (device_out, queue);
+    pool_free(device_in, queue);
+    pool_free(device_kernel, queue);
+    pool_free(device_out, queue);
+    MemoryPool::instance().print_stats();
+    MemoryPool::instance().release();
     return 0;
 
     return 0;
 }
 
-void check_result(const std::vector<DTYPE>& in, const std::vector<DTYPE>& kernel, const std::vector<DTYPE>&out ) {
+// The leading n*n elements of in and out are checked as [n,n] matrices, kernel is [k_size,k_size]
+void check_result(const std::vector<DTYPE>& in, const std::vector<DTYPE>& kernel, const std::vector<DTYPE>&out, const int n, const int k_size) {
     
-    int kernel_half_size = KERNEL_SIZE/2;
-    DTYPE sum;
-    int y, x, ky, kx;
-    for (y=0; y<N; y++) {
-        for (x=0; x<N; x++) {
-
-            // Get a gt value
-            sum = 0;
-            for (ky=-kernel_half_size; ky<=kernel_half_size; ky++) {
-                for (kx=-kernel_half_size; kx<=kernel_half_size; kx++) {
-                    if (0<=x+kx && x+kx<N && 0<=y+ky && y+ky<N) {
-                        sum += in[(y+ky)*N+x+kx] * kernel[(ky+kernel_half_size)*KERNEL_SIZE+(kx+kernel_half_size)];
-                    }
-                }
-            }
+    const int kernel_half_size = k_size/2;
+    validate((size_t)n*n, [&](size_t i) {
 
-            // Check result
-            if (out[y*N+x] != sum) {
-                std::cout << "--- [[[ERROR]]] Checking the result failed at ["<<y<<","<<x<<"], gt("<<sum<<") != result("<<out[y*N+x]<<") !!\n";
-                return ;
+        int y = i/n, x = i%n;
+        DTYPE sum = 0;
+        for (int ky=-kernel_half_size; ky<=kernel_half_size; ky++) {
+            for (int kx=-kernel_half_size; kx<=kernel_half_size; kx++) {
+                if (0<=x+kx && x+kx<n && 0<=y+ky && y+ky<n) {
+                    sum += in[(y+ky)*n+x+kx] * kernel[(ky+kernel_half_size)*k_size+(kx+kernel_half_size)];
+                }
             }
-
         }
-    }
-            
-    std::cout << "--- Checking the result succeed!!\n";
+        return sum;
+
+    }, out.data(), n);
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../../common/layout.hpp"
+#include "transpose_coalesced.hpp"
+
+
+/********************************************************
+ *  Transpose of a matrix in a blocked or morton layout (common/layout.hpp)
+ *  - in_layout is the layout of in, out gets in_layout.transposed() (allocate out with its size, and pass
+ *    it to the next call or to from_layout), so the transpose is a permutation of the tiles
+ *    (tile [ty,tx] of in becomes tile [tx,ty] of out) plus a swap inside each tile
+ *  - One work-group per tile : the tile is read and written as one contiguous block of tile x tile elements,
+ *    the swap goes through local memory padded against bank conflicts
+ *  - The padding of in is zero, so is the padding of out
+ *  - A row-major layout falls back to transpose_coalesced
+ ********************************************************/
+template <typename T, size_t WPI=4>
+sycl::event transpose_blocked(sycl::queue& queue, const T* in, T* out, const MatrixLayout in_layout) {
+
+    if (in_layout.layout == Layout::row_major)
+        return transpose_coalesced<T>(queue, in, out, in_layout.rows, in_layout.cols);
+
+    const MatrixLayout out_layout = in_layout.transposed();
+    const size_t tile = in_layout.tile;
+    const size_t block = tile/WPI;
+
+    return queue.submit([&] (sycl::handler& cgh) {
+        sycl::accessor<T, 2, sycl::access::mode::read_write, sycl::access::target::local> local_in(sycl::range<2>(tile, tile+1), cgh);
+        cgh.parallel_for(sycl::nd_range<2>({in_layout.tiles_rows*block, in_layout.tiles_cols*tile}, {block, tile}), [=](sycl::nd_item<2> item){
+
+            size_t ty = item.get_group(0);
+            size_t tx = item.get_group(1);
+            int ly = item.get_local_id(0);
+            int lx = item.get_local_id(1);
+
+            const T* src = in+in_layout.tile_offset(ty, tx);
+            for (size_t work=0; work<WPI; work++)
+                local_in[ly+work*block][lx] = src[(ly+work*block)*tile+lx];
+
+            item.barrier(sycl::access::fence_space::local_space);
+
+            T* dst = out+out_layout.tile_offset(tx, ty);
+            for (size_t work=0; work<WPI; work++)
+                dst[(ly+work*block)*tile+lx] = local_in[lx][ly+work*block];
+        });
+    });
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../../common/roofline.hpp"
+
+
+/*** Roofline cost shared by the transpose implementations : every element is read once and written once ***/
+template <typename T>
+KernelCost transpose_cost(const size_t rows, const size_t cols) {
+    return KernelCost{(double)sizeof(T)*rows*cols, (double)sizeof(T)*rows*cols, 0};
+}
+
+
+/********************************************************
+ *  Coalesced transpose via local memory without bank conflict, for any [rows,cols] matrix
+ *  - Each work-group moves a TILE x TILE tile, each workitem handles WPI rows of the tile
+ *  - The fastest varying dimension (1) walks along the columns, so both global reads and writes are coalesced
+ *  - Returns without waiting (used by the multi-device and chunked drivers)
+ ********************************************************/
+template <typename T, size_t TILE=32, size_t WPI=4>
+sycl::event transpose_coalesced(sycl::queue& queue, const T* in, T* out, const size_t rows, const size_t cols) {
+
+    constexpr size_t BLOCK = TILE/WPI;
+    size_t ceil_rows = ((rows+TILE-1)/TILE)*TILE;
+    size_t ceil_cols = ((cols+TILE-1)/TILE)*TILE;
+
+    return queue.submit([&] (sycl::handler& cgh) {
+        sycl::accessor<T, 2, sycl::access::mode::read_write, sycl::access::target::local> local_in(sycl::range<2>(TILE,TILE+1), cgh);
+        cgh.parallel_for(sycl::nd_range<2>({ceil_rows/WPI, ceil_cols}, {BLOCK, TILE}), [=](sycl::nd_item<2> item){
+
+            size_t y_start = item.get_group(0)*TILE;
+            size_t x_start = item.get_group(1)*TILE;
+            int ly = item.get_local_id(0);
+            int lx = item.get_local_id(1);
+
+            // Load the tile [y_start, x_start] into local memory
+            for (int work=0; work<WPI; work++) {
+                size_t y = y_start+ly+work*BLOCK;
+                size_t x = x_start+lx;
+                if (y<rows && x<cols)
+                    local_in[ly+work*BLOCK][lx] = in[y*cols+x];
+            }
+
+            // Synchronizing all the workitems in a group
+            item.barrier(sycl::access::fence_space::local_space);
+
+            // Store it as the tile [x_start, y_start] of the output
+            for (int work=0; work<WPI; work++) {
+                size_t y = x_start+ly+work*BLOCK;
+                size_t x = y_start+lx;
+                if (y<cols && x<rows)
+                    out[y*rows+x] = local_in[lx][ly+work*BLOCK];
+            }
+        });
+    });
+}
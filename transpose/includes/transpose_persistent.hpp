@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../../common/persistent.hpp"
+#include "transpose_coalesced.hpp"
+
+
+/********************************************************
+ *  Persistent coalesced transpose
+ *  - Same tile movement as transpose_coalesced, but a device-sized grid of TILE x TILE/WPI work-groups
+ *    loops over the tiles (grid-stride or atomic work queue, see common/persistent.hpp)
+ *  - Tiles are numbered row-major over the input, the local memory tile is reused from one tile to the next
+ ********************************************************/
+template <typename T, size_t TILE=32, size_t WPI=4>
+sycl::event transpose_persistent(sycl::queue& queue, const T* in, T* out, const size_t rows, const size_t cols, Schedule schedule) {
+
+    if (schedule == Schedule::launch_per_element)
+        return transpose_coalesced<T, TILE, WPI>(queue, in, out, rows, cols);
+
+    constexpr size_t BLOCK = TILE/WPI;
+    const size_t tiles_x = (cols+TILE-1)/TILE;
+    const size_t num_tiles = ((rows+TILE-1)/TILE)*tiles_x;
+
+    return persistent_launch(queue, schedule, BLOCK*TILE, num_tiles, [&](sycl::handler& cgh, size_t num_groups, unsigned int* counter) {
+
+        sycl::accessor<T, 2, sycl::access::mode::read_write, sycl::access::target::local> local_in(sycl::range<2>(TILE,TILE+1), cgh);
+        cgh.parallel_for(sycl::nd_range<1>(num_groups*BLOCK*TILE, BLOCK*TILE), [=](sycl::nd_item<1> item) {
+
+            int ly = item.get_local_id(0)/TILE;
+            int lx = item.get_local_id(0)%TILE;
+
+            persistent_for(item, num_tiles, counter, [&](size_t tile) {
+
+                size_t y_start = (tile/tiles_x)*TILE;
+                size_t x_start = (tile%tiles_x)*TILE;
+
+                for (int work=0; work<WPI; work++) {
+                    size_t y = y_start+ly+work*BLOCK;
+                    size_t x = x_start+lx;
+                    if (y<rows && x<cols)
+                        local_in[ly+work*BLOCK][lx] = in[y*cols+x];
+                }
+                item.barrier(sycl::access::fence_space::local_space);
+
+                for (int work=0; work<WPI; work++) {
+                    size_t y = x_start+ly+work*BLOCK;
+                    size_t x = y_start+lx;
+                    if (y<cols && x<rows)
+                        out[y*rows+x] = local_in[lx][ly+work*BLOCK];
+                }
+
+                // The next tile overwrites local_in
+                item.barrier(sycl::access::fence_space::local_space);
+            });
+        });
+    });
+}
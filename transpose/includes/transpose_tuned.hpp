@@ -0,0 +1,44 @@
+#pragma once
+
+#include "transpose_coalesced.hpp"
+#include "../../common/autotune.hpp"
+
+
+/*** Tuned configuration : {tile size, work per item} ***/
+template <typename T, size_t TILE>
+sycl::event transpose_dispatch_tile(sycl::queue& queue, const T* in, T* out, const size_t rows, const size_t cols, int wpi) {
+
+    switch (wpi) {
+        case 1:  return transpose_coalesced<T, TILE, 1>(queue, in, out, rows, cols);
+        case 2:  return transpose_coalesced<T, TILE, 2>(queue, in, out, rows, cols);
+        case 4:  return transpose_coalesced<T, TILE, 4>(queue, in, out, rows, cols);
+        default: return transpose_coalesced<T, TILE, 8>(queue, in, out, rows, cols);
+    }
+}
+
+template <typename T>
+sycl::event transpose_dispatch(sycl::queue& queue, const T* in, T* out, const size_t rows, const size_t cols, const TuningConfig& config) {
+
+    switch (config[0]) {
+        case 16: return transpose_dispatch_tile<T, 16>(queue, in, out, rows, cols, config[1]);
+        case 32: return transpose_dispatch_tile<T, 32>(queue, in, out, rows, cols, config[1]);
+        default: return transpose_dispatch_tile<T, 64>(queue, in, out, rows, cols, config[1]);
+    }
+}
+
+template <typename T>
+void transpose_auto(sycl::queue& queue, const T* in, T* out, const size_t rows, const size_t cols) {
+
+    size_t max_local = queue.get_device().get_info<sycl::info::device::max_work_group_size>();
+    size_t local_mem = queue.get_device().get_info<sycl::info::device::local_mem_size>();
+    auto space = tuning_space({{16, 32, 64}, {1, 2, 4, 8}}, [&](const TuningConfig& c) {
+        return (size_t)(c[0]*c[0]/c[1]) <= max_local && c[0]*(c[0]+1)*sizeof(T) <= local_mem;
+    });
+
+    TuningConfig config = autotune(tuning_key<T>("transpose", queue, rows*cols), space, [&](const TuningConfig& c) {
+        transpose_dispatch(queue, in, out, rows, cols, c).wait();
+    });
+
+    transpose_dispatch(queue, in, out, rows, cols, config);
+    queue.wait();
+}
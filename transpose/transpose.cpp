@@ -4,20 +4,36 @@
 #include <CL/sycl.hpp>
 #include <algorithm>
 namespace sycl=cl::sycl;
+#include "../common/memory_pool.hpp"
+#include "../common/device_select.hpp"
+#include "../common/roofline.hpp"
+#include "../common/validation.hpp"
+#include "../common/multi_device.hpp"
+#include "../common/graph.hpp"
+#include "../common/streaming.hpp"
+#include "../common/mapped_file.hpp"
 
 #define ELAPSED_TIME(st, ed) ((ed.tv_sec - st.tv_sec) + ((ed.tv_usec-st.tv_usec)*1e-6))
 timeval start, end;
 
 #define DTYPE float
+#ifdef __MODE_SMALL_PROBLEM__
+const size_t M=1024*8, N=1024*8;
+#else
 const size_t M=1024*30, N=1024*30;
+#endif
 const size_t DIM_TILE=32;
 const size_t WORK_PER_ITEM=4;
 const size_t BLOCK_ROWS=DIM_TILE/WORK_PER_ITEM;
 
 
 // Debugging info
-//#define __MODE_DEBUG_TIME__
+#define __MODE_DEBUG_TIME__
 const size_t NUM_TESTS=20;
+const int NUM_REPLAYS=200;
+const size_t NUM_STREAM_CHUNKS=32;    // row blocks of the file ingestion
+const size_t NUM_STREAMS=3;
+const int NUM_PIPELINE=9;    // transposes chained in the blocked layout pipeline (odd : the result is transposed)
 void check_result(const std::vector<DTYPE>&,const std::vector<DTYPE>&);
 
 // Kernels
@@ -25,13 +41,17 @@ void transpose_naive(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_o
 void transpose_shared_memory(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out);
 void transpose_coalesced_shared_memory(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out);
 void transpose_no_bank_conflict(sycl::queue& queue, const DTYPE* device_in, DTYPE* device_out);
+#include "includes/transpose_coalesced.hpp"
+#include "includes/transpose_tuned.hpp"
+#include "includes/transpose_persistent.hpp"
+#include "includes/transpose_blocked.hpp"
 
 
-int main(void) {
+int main(int argc, char* argv[]) {
 
     std::cout << "=================================================\n";
     std::cout << "SYCL Primitives : Parallel Traspose\n";
-    std::cout << "-- a single nvidia GPU example\n";
+    std::cout << "-- a single device example (--device=<gpu|cpu|acc|index|name>)\n";
     std::cout << "-- 2D matrix transpose opertaion : in["<<M<<","<<N<<"] -> "<<"out["<<N<<","<<M<<"]\n";
     std::cout << "-- 2D matrix size: "<<2*sizeof(DTYPE)*M*N/1024.0/1024.0/1024.0<<" GB\n";
     std::cout << "=================================================\n\n";
@@ -39,8 +59,9 @@ int main(void) {
     /********************************************************
      *  SYCL setup
      ********************************************************/
-    sycl::gpu_selector device;
-    sycl::queue queue(device);
+    sycl::queue queue(select_device(argc, argv));
+    std::cout << "Running on "<<queue.get_device().get_info<sycl::info::device::name>()<<"\n";
+    measure_roof<DTYPE>(queue);    // one-time bandwidth and compute roof of the device
 
 
     /********************************************************
@@ -48,12 +69,12 @@ int main(void) {
      ********************************************************/
     std::vector<DTYPE> in(M*N);
     std::generate(in.begin(), in.end(), std::rand);
-    DTYPE* device_in = sycl::malloc_device<DTYPE>(M*N, queue);
+    DTYPE* device_in = pool_malloc_device<DTYPE>(M*N, queue);
     queue.memcpy(device_in, in.data(), M*N*sizeof(DTYPE));
     queue.wait();
 
     std::vector<DTYPE> out(M*N);
-    DTYPE* device_out = sycl::malloc_device<DTYPE>(M*N, queue);
+    DTYPE* device_out = pool_malloc_device<DTYPE>(M*N, queue);
 
     /********************************************************
      *  Naive implementation
@@ -65,8 +86,7 @@ int main(void) {
         transpose_naive(queue, device_in, device_out);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*M*N/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
+    roofline_report<DTYPE>(queue, transpose_cost<DTYPE>(M, N), ELAPSED_TIME(start, end)/NUM_TESTS);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(out.data(), device_out, M*N*sizeof(DTYPE));
@@ -85,8 +105,7 @@ int main(void) {
         transpose_shared_memory(queue, device_in, device_out);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*M*N/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
+    roofline_report<DTYPE>(queue, transpose_cost<DTYPE>(M, N), ELAPSED_TIME(start, end)/NUM_TESTS);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(out.data(), device_out, M*N*sizeof(DTYPE));
@@ -106,8 +125,7 @@ int main(void) {
         transpose_coalesced_shared_memory(queue, device_in, device_out);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*M*N/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
+    roofline_report<DTYPE>(queue, transpose_cost<DTYPE>(M, N), ELAPSED_TIME(start, end)/NUM_TESTS);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(out.data(), device_out, M*N*sizeof(DTYPE));
@@ -126,8 +144,7 @@ int main(void) {
         transpose_no_bank_conflict(queue, device_in, device_out);
     }   
     gettimeofday(&end, NULL);
-    std::cout << "-- Elasped time : "<<ELAPSED_TIME(start, end)/NUM_TESTS<<" s\n";
-    std::cout << "-- Effective bandwidth : "<<sizeof(DTYPE)*M*N/1024.0/1024.0/1024.0/(ELAPSED_TIME(start, end)/NUM_TESTS)<<" GB/s\n";
+    roofline_report<DTYPE>(queue, transpose_cost<DTYPE>(M, N), ELAPSED_TIME(start, end)/NUM_TESTS);
 
     #ifdef __MODE_DEBUG_TIME__
     queue.memcpy(out.data(), device_out, M*N*sizeof(DTYPE));
@@ -136,9 +153,284 @@ int main(void) {
     #endif
 
 
+    /********************************************************
+     *  Auto-tuned coalesced transpose : {tile size, work per item}
+     ********************************************************/
+
+    std::cout << "\nAuto-tuned coalesced transpose (tuning cache : "<<TuningCache::instance().file()<<")\n";
+    transpose_auto(queue, device_in, device_out, M, N);    // tunes on the first call, then reads the cache
+    gettimeofday(&start, NULL);
+    for (int test=0; test<NUM_TESTS; test++){
+        transpose_auto(queue, device_in, device_out, M, N);
+    }
+    gettimeofday(&end, NULL);
+    roofline_report<DTYPE>(queue, transpose_cost<DTYPE>(M, N), ELAPSED_TIME(start, end)/NUM_TESTS);
+
+    #ifdef __MODE_DEBUG_TIME__
+    queue.memcpy(out.data(), device_out, M*N*sizeof(DTYPE));
+    queue.wait();
+    check_result(in, out);
+    #endif
+
+
+    /********************************************************
+     *  Persistent coalesced transpose vs one work-group per tile across problem sizes
+     ********************************************************/
+    std::cout << "\nPersistent coalesced transpose (device-sized grid) vs launch per tile\n";
+    for (size_t n : {M/8, M/4, M/2, M}) {
+        std::cout << "- "<<n<<"x"<<n<<" matrix\n";
+        for (Schedule schedule : {Schedule::launch_per_element, Schedule::grid_stride, Schedule::work_queue}) {
+            transpose_persistent<DTYPE>(queue, device_in, device_out, n, n, schedule).wait();    // warming up
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++){
+                transpose_persistent<DTYPE>(queue, device_in, device_out, n, n, schedule).wait();
+            }
+            gettimeofday(&end, NULL);
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            std::cout << "-- "<<schedule_name(schedule)<<" : "<<time<<" s, "<<transpose_cost<DTYPE>(n, n).bytes()/1024.0/1024.0/1024.0/time<<" GB/s\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            if (n == M && M == N) {
+                queue.memcpy(out.data(), device_out, M*N*sizeof(DTYPE));
+                queue.wait();
+                check_result(in, out);
+            }
+            #endif
+        }
+    }
+
+
+    /********************************************************
+     *  Blocked layouts : pipeline of NUM_PIPELINE transposes of a rows x cols matrix
+     *  - row-major : transpose_coalesced back and forth between two buffers
+     *  - blocked / morton : one conversion in, the transposes on the tiles, one conversion out
+     *  - The matrix is not square and cols is not a multiple of the tile, so every step works on the
+     *    transposed layout of the previous one and the padding is exercised
+     ********************************************************/
+    std::cout << "\nTranspose pipeline in blocked layouts ("<<NUM_PIPELINE<<" transposes)\n";
+    {
+        const size_t rows = std::min(M, N)/2;
+        const size_t cols = rows/2+DIM_TILE/2;
+        std::cout << "- "<<rows<<"x"<<cols<<" matrix (the leading rows*cols elements of in)\n";
+        double row_major_time = 0;
+        for (Layout layout : {Layout::row_major, Layout::blocked, Layout::morton}) {
+
+            MatrixLayout shape(layout, rows, cols, DIM_TILE);
+            const size_t size = std::max(shape.size(), shape.transposed().size());
+            DTYPE* device_a = pool_malloc_device<DTYPE>(size, queue);
+            DTYPE* device_b = pool_malloc_device<DTYPE>(size, queue);
+
+            auto pipeline = [&]() {
+                to_layout<DTYPE>(queue, device_in, device_a, shape).wait();
+                DTYPE* src = device_a;
+                DTYPE* dst = device_b;
+                MatrixLayout current = shape;
+                for (int step=0; step<NUM_PIPELINE; step++) {
+                    transpose_blocked<DTYPE>(queue, src, dst, current).wait();
+                    current = current.transposed();
+                    std::swap(src, dst);
+                }
+                from_layout<DTYPE>(queue, src, device_out, current).wait();
+            };
+
+            pipeline();    // warming up
+            gettimeofday(&start, NULL);
+            for (int test=0; test<NUM_TESTS; test++){
+                pipeline();
+            }
+            gettimeofday(&end, NULL);
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            if (layout == Layout::row_major) row_major_time = time;
+            std::cout << "-- "<<layout_name(layout)<<" : "<<time<<" s ("<<NUM_PIPELINE*transpose_cost<DTYPE>(rows, cols).bytes()/1024.0/1024.0/1024.0/time
+                      <<" GB/s of transposes, speedup "<<row_major_time/time<<"x)\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            queue.memcpy(out.data(), device_out, rows*cols*sizeof(DTYPE));
+            queue.wait();
+            validate(rows*cols, [&](size_t i) { return in[(i%rows)*cols+i/rows]; }, out.data(), rows);
+            #endif
+
+            pool_free(device_a, queue);
+            pool_free(device_b, queue);
+        }
+    }
+
+
+    /********************************************************
+     *  Record and replay of a two-step pipeline : transpose into a scratch buffer and back
+     *  - Iterations alternate between two (in, out) buffer pairs, so the replay updates its pointers
+     ********************************************************/
+    std::cout << "\nRecorded pipeline replay vs re-submission ("<<NUM_REPLAYS<<" iterations)\n";
+    for (size_t n : {M/32, M/8}) {
+        RecordReplay replay(queue);
+        DTYPE* device_tmp = pool_malloc_device<DTYPE>(n*n, queue);
+
+        auto pipeline = [&](sycl::queue& q, int i) {
+            transpose_coalesced<DTYPE>(q, device_in+(i%2)*n*n, device_tmp, n, n);
+            return transpose_coalesced<DTYPE>(q, device_tmp, device_out+(i%2)*n*n, n, n);
+        };
+
+        std::cout << "- "<<n<<"x"<<n<<" matrix ("<<(replay.is_native() ? "sycl_ext_oneapi_graph" : "no graph support, re-submission")<<")\n";
+        measure_submission(replay.queue(), NUM_REPLAYS, [&](int i) {
+            pipeline(replay.queue(), i);
+        }).print("re-submission");
+        measure_submission(replay.queue(), NUM_REPLAYS, [&](int i) {
+            replay.run({device_in+(i%2)*n*n, device_tmp, device_out+(i%2)*n*n}, [&](sycl::queue& q) { return pipeline(q, i); });
+        }).print("replay");
+        std::cout << "-- recorded graphs : "<<replay.num_graphs()<<"\n";
+
+        #ifdef __MODE_DEBUG_TIME__
+        queue.memcpy(out.data(), device_out, 2*n*n*sizeof(DTYPE));
+        queue.wait();
+        validate(2*n*n, [&](size_t i) { return in[i]; }, out.data(), n);    // transposed twice
+        #endif
+
+        pool_free(device_tmp, queue);
+    }
+
+
+    /********************************************************
+     *  Multi-device partitioning : split by tile rows
+     *  - Device d transposes the rows [begin,end) of in into the columns [begin,end) of out
+     ********************************************************/
+    std::cout << "\nMulti-device coalesced transpose (partitioned by tile rows)\n";
+    {
+        MultiDeviceExecutor executor;
+        executor.calibrate();
+        executor.print_devices();
+
+        std::vector<DTYPE*> part_in(executor.num_devices()), part_out(executor.num_devices());
+        double base_time = 0;
+
+        for (size_t num_devices=1; num_devices<=executor.num_devices(); num_devices++) {
+
+            executor.use_devices(num_devices);
+            auto parts = executor.partition(M, DIM_TILE);
+
+            // Scatter
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                part_in[part.index] = pool_malloc_device<DTYPE>(part.size()*N, q);
+                part_out[part.index] = pool_malloc_device<DTYPE>(N*part.size(), q);
+                q.memcpy(part_in[part.index], in.data()+part.begin*N, part.size()*N*sizeof(DTYPE)).wait();
+                transpose_coalesced<DTYPE, DIM_TILE, WORK_PER_ITEM>(q, part_in[part.index], part_out[part.index], part.size(), N).wait();    // warming up
+            });
+
+            gettimeofday(&start, NULL);
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                for (int test=0; test<NUM_TESTS; test++)
+                    transpose_coalesced<DTYPE, DIM_TILE, WORK_PER_ITEM>(q, part_in[part.index], part_out[part.index], part.size(), N).wait();
+            });
+            gettimeofday(&end, NULL);
+
+            // Gather : the [N,rows] block becomes the columns [begin,end) of out
+            executor.run(parts, [&](const DevicePartition& part, sycl::queue& q) {
+                std::vector<DTYPE> block(N*part.size());
+                q.memcpy(block.data(), part_out[part.index], N*part.size()*sizeof(DTYPE)).wait();
+                for (size_t x=0; x<N; x++)
+                    std::copy(block.begin()+x*part.size(), block.begin()+(x+1)*part.size(), out.begin()+x*M+part.begin);
+                pool_free(part_in[part.index], q);
+                pool_free(part_out[part.index], q);
+            });
+
+            double time = ELAPSED_TIME(start, end)/NUM_TESTS;
+            if (num_devices == 1) base_time = time;
+            std::cout << "- "<<num_devices<<" device(s)\n";
+            std::cout << "-- Elasped time : "<<time<<" s (speedup "<<base_time/time<<"x)\n";
+            std::cout << "-- Effective bandwidth : "<<transpose_cost<DTYPE>(M, N).bytes()/1024.0/1024.0/1024.0/time<<" GB/s\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            check_result(in, out);
+            #endif
+        }
+    }
+
+
+    /********************************************************
+     *  File ingestion : input file -> transpose -> output file, by blocks of input rows
+     *  - read then memcpy : fread the whole file into a host vector, one H2D copy, transpose, one D2H copy, fwrite
+     *  - memory-mapped : a block of rows goes from the input mapping to the device (directly where the mapping
+     *    can be registered), its transpose is a block of columns of the output, written into the output mapping
+     *  - A failed write, read or mapping is reported and skips the comparison
+     *  - The input was just written, so both read it from a warm page cache
+     ********************************************************/
+    std::cout << "\nFile ingestion : memory-mapped row blocks vs read then memcpy ("<<NUM_STREAM_CHUNKS<<" blocks)\n";
+    {
+        const std::string in_path = data_file_path("sycl_primitives_transpose_in.npy");
+        const std::string out_path = data_file_path("sycl_primitives_transpose_out.npy");
+        bool ok = npy_fwrite(in_path, in.data(), {M, N});
+
+        gettimeofday(&start, NULL);
+        ok = ok && npy_fread(in_path, out.data(), M*N);
+        if (ok) {
+            queue.memcpy(device_in, out.data(), M*N*sizeof(DTYPE)).wait();
+            transpose_coalesced<DTYPE, DIM_TILE, WORK_PER_ITEM>(queue, device_in, device_out, M, N).wait();
+            queue.memcpy(out.data(), device_out, M*N*sizeof(DTYPE)).wait();
+        }
+        ok = ok && npy_fwrite(out_path, out.data(), {N, M});
+        gettimeofday(&end, NULL);
+        double baseline_time = ELAPSED_TIME(start, end);
+
+        bool direct = false;
+        gettimeofday(&start, NULL);
+        if (ok) {
+            MappedFile input = MappedFile::open<DTYPE>(in_path, M*N);
+            MappedFile output = MappedFile::create<DTYPE>(out_path, {N, M});
+            ok = input.is_open() && output.is_open();
+            direct = ok && input.register_for_device_copy(queue);
+            const DTYPE* file_in = input.data<DTYPE>();
+            DTYPE* file_out = output.data<DTYPE>();
+
+            const size_t block_rows = ((M+NUM_STREAM_CHUNKS-1)/NUM_STREAM_CHUNKS+DIM_TILE-1)/DIM_TILE*DIM_TILE;
+            const size_t num_blocks = (M+block_rows-1)/block_rows;
+            StreamingEngine<DTYPE> engine(queue, block_rows*N, N*block_rows, NUM_STREAMS);
+            auto rows = [&](size_t block) { return std::min(block_rows, M-block*block_rows); };
+
+            auto pack = [&](size_t block, DTYPE* staging_in) {
+                size_t count = rows(block)*N;
+                input.prefetch((block+1)*block_rows*N*sizeof(DTYPE), block_rows*N*sizeof(DTYPE));
+                if (direct) return StreamChunk{count, count, file_in+block*block_rows*N};
+                std::memcpy(staging_in, file_in+block*block_rows*N, count*sizeof(DTYPE));
+                return StreamChunk{count, count};
+            };
+            auto launch = [&](sycl::queue& stream, size_t block, const DTYPE* d_in, DTYPE* d_out) {
+                return transpose_coalesced<DTYPE, DIM_TILE, WORK_PER_ITEM>(stream, d_in, d_out, rows(block), N);
+            };
+            // The [N, rows] result is the columns [block*block_rows, +rows) of the [N, M] output
+            auto unpack = [&](size_t block, const DTYPE* staging_out, size_t count) {
+                size_t rb = rows(block);
+                for (size_t x=0; x<N; x++)
+                    std::memcpy(file_out+x*M+block*block_rows, staging_out+x*rb, rb*sizeof(DTYPE));
+            };
+            if (ok) engine.run(num_blocks, pack, launch, unpack);
+        }
+        gettimeofday(&end, NULL);
+        double mapped_time = ELAPSED_TIME(start, end);
+
+        if (!ok) std::cout << "--- [[[ERROR]]] File I/O failed, skipping the file ingestion comparison !!\n";
+        else {
+            double file_bytes = 2.0*sizeof(DTYPE)*M*N;
+            std::cout << "- read then memcpy : "<<baseline_time<<" s, "<<file_bytes/1024.0/1024.0/1024.0/baseline_time<<" GB/s file to file\n";
+            std::cout << "- memory-mapped ("<<(direct ? "registered input, direct copies" : "staged through pinned buffers")<<") : "
+                      <<mapped_time<<" s, "<<file_bytes/1024.0/1024.0/1024.0/mapped_time<<" GB/s file to file (speedup "<<baseline_time/mapped_time<<"x)\n";
+
+            #ifdef __MODE_DEBUG_TIME__
+            MappedFile result = MappedFile::open<DTYPE>(out_path, M*N);
+            if (result.is_open()) validate(M*N, [&](size_t i) { return in[(i%M)*N+i/M]; }, result.data<DTYPE>(), M);
+            #endif
+        }
+
+        std::remove(in_path.c_str());
+        std::remove(out_path.c_str());
+    }
+
+
     /********************************************************
      *  Finalize
      ********************************************************/
+    pool_free(device_in, queue);
+    pool_free(device_out, queue);
+    MemoryPool::instance().print_stats();
+    MemoryPool::instance().release();
     return 0;
 }
 
@@ -279,14 +571,6 @@ void transpose_no_bank_conflict(sycl::queue& queue, const DTYPE* device_in, DTYP
 
 void check_result(const std::vector<DTYPE>& in, const std::vector<DTYPE>& out) {
 
-    for (int y=0; y<M; y++) {
-        for (int x=0; x<N; x++) {
-            if (in[y*N+x] != out[x*M+y]) {
-                std::cout << "--- [[[ERROR]]] Checking the result failed at ["<<x<<","<<y<<"] "<<out[x*M+y]<<" !!\n";
-                return ;
-            }
-        }
-    }
-
-    std::cout << "--- Checking the result succeed!!\n";
+    // out[x,y] == in[y,x]
+    validate(M*N, [&](size_t i) { return in[(i%M)*N+i/M]; }, out.data(), M);
 }
\ No newline at end of file